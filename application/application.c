@@ -44,6 +44,8 @@ unsigned application_configure ( application_t * application, unsigned options )
       if ( NRF_SUCCESS == beacon_start ( BEACON_BROADCAST_VARIANT ) ) {
 
         beacon_notice ( BEACON_NOTICE_INSPECTED, &(application->status), APPLICATION_EVENT_PROBED );
+        beacon_network ( &(application->settings.tracking.node) );
+        beacon_survey ( BEACON_SURVEY_PERIOD );
 
         }
 
@@ -82,6 +84,7 @@ unsigned application_configure ( application_t * application, unsigned options )
 
       sensors_notice ( SENSORS_NOTICE_TELEMETRY, &(application->status), APPLICATION_EVENT_TELEMETRY );
       sensors_notice ( SENSORS_NOTICE_ARCHIVE, &(application->status), APPLICATION_EVENT_ARCHIVE );
+      sensors_notice ( SENSORS_NOTICE_MEASURED, &(application->status), APPLICATION_EVENT_AMBIENT );
 
       sensors_begin ( application->settings.telemetry.interval, application->settings.telemetry.archival );
 
@@ -99,11 +102,17 @@ unsigned application_configure ( application_t * application, unsigned options )
 
       movement_notice ( MOVEMENT_NOTICE_ORIENTATION, &(application->status), APPLICATION_EVENT_ORIENTED );
       movement_notice ( MOVEMENT_NOTICE_PERIODIC, &(application->status), APPLICATION_EVENT_HANDLING );
+      movement_notice ( MOVEMENT_NOTICE_MEASURED, &(application->status), APPLICATION_EVENT_SURFACE );
+
+      movement_notice ( MOVEMENT_NOTICE_STARTED, &(application->status), APPLICATION_EVENT_CADENCE );
+      movement_notice ( MOVEMENT_NOTICE_STOPPED, &(application->status), APPLICATION_EVENT_CADENCE );
 
       movement_notice ( MOVEMENT_NOTICE_FREEFALL, &(application->status), APPLICATION_EVENT_DROPPED );
       movement_notice ( MOVEMENT_NOTICE_STRESS, &(application->status), APPLICATION_EVENT_STRESSED );
       movement_notice ( MOVEMENT_NOTICE_TILT, &(application->status), APPLICATION_EVENT_TILTED );
 
+      movement_notice ( MOVEMENT_NOTICE_SAMPLES, &(application->status), APPLICATION_EVENT_SAMPLES );
+
       movement_begin ( application->settings.telemetry.interval );
 
       }
@@ -127,7 +136,21 @@ unsigned application_configure ( application_t * application, unsigned options )
 
 unsigned application_bluetooth ( application_t * application ) {
 
-  unsigned                     result = bluetooth_start ( APPLICATION_NAME );
+  unsigned                   services = 0;
+  unsigned                     result;
+
+  // Select the sensor services from the platform options. The surface
+  // temperature is measured by the motion unit, while the atmospheric
+  // telemetry requires either the pressure or the humidity sensor. The
+  // telemetry settings are only useful if a sensor is present.
+
+  if ( application->option & PLATFORM_OPTION_MOTION ) { services |= BLUETOOTH_SERVICE_SURFACE | BLUETOOTH_SERVICE_HANDLING; }
+  if ( application->option & (PLATFORM_OPTION_PRESSURE | PLATFORM_OPTION_HUMIDITY) ) { services |= BLUETOOTH_SERVICE_ATMOSPHERE; }
+  if ( services ) { services |= BLUETOOTH_SERVICE_TELEMETRY; }
+
+  // Start the stack with an attribute table sized for the selected services.
+
+  result                              = bluetooth_start ( APPLICATION_NAME, services );
 
   // Add the device battery information service class and declare a fixed, rechargable battery type.
 
@@ -150,6 +173,9 @@ unsigned application_bluetooth ( application_t * application ) {
                                                              application->settings.tracking.lock,
                                                              application->settings.tracking.signature.opened,
                                                              application->settings.tracking.signature.closed ); }
+  if ( NRF_SUCCESS == result ) { control_notice ( CONTROL_NOTICE_SETTINGS, &(application->status), APPLICATION_EVENT_PROVISION ); }
+  if ( NRF_SUCCESS == result ) { control_notice ( CONTROL_NOTICE_MEASURE, &(application->status), APPLICATION_EVENT_MEASURE ); }
+  if ( NRF_SUCCESS == result ) { control_notice ( CONTROL_NOTICE_LOCATION, &(application->status), APPLICATION_EVENT_LOCATED ); }
 
   // Add the device information service class and include the system firmware version.
 
@@ -169,15 +195,44 @@ unsigned application_bluetooth ( application_t * application ) {
 
     }
 
-  // Add the telemetry data service and initialize the telemetry settings.
+  // Add the surface temperature service if the motion unit is present.
+
+  if ( services & BLUETOOTH_SERVICE_SURFACE ) {
+
+    if ( NRF_SUCCESS == result ) { result = surface_register ( application->settings.surface.lower, application->settings.surface.upper ); }
+
+    }
+
+  // Add the telemetry settings service and request notice of interval changes.
+
+  if ( services & BLUETOOTH_SERVICE_TELEMETRY ) {
+
+    if ( NRF_SUCCESS == result ) { result = telemetry_register ( application->settings.telemetry.interval, application->settings.telemetry.archival ); }
+    if ( NRF_SUCCESS == result ) { telemetry_notice ( TELEMETRY_NOTICE_CHANGED, &(application->status), APPLICATION_EVENT_RETIMED ); }
+
+    }
+
+  // Add the atmospheric telemetry service if either atmospheric sensor is present.
+
+  if ( services & BLUETOOTH_SERVICE_ATMOSPHERE ) {
+
+    if ( NRF_SUCCESS == result ) { result = atmosphere_register ( &(application->settings.atmosphere.lower), &(application->settings.atmosphere.upper) ); }
+
+    }
+
+  // Add the orientation and handling service and request notice of changes to
+  // the raw motion stream subscription.
 
-  if ( NRF_SUCCESS == result ) { result = surface_register ( application->settings.surface.lower, application->settings.surface.upper ); }
-  if ( NRF_SUCCESS == result ) { result = telemetry_register ( application->settings.telemetry.interval, application->settings.telemetry.archival ); }
-  if ( NRF_SUCCESS == result ) { result = atmosphere_register ( &(application->settings.atmosphere.lower), &(application->settings.atmosphere.upper) ); }
+  if ( services & BLUETOOTH_SERVICE_HANDLING ) {
 
-  // Add the orientation and handling service.
+    if ( NRF_SUCCESS == result ) { result = handling_register ( &(application->settings.handling.limit) ); }
+    if ( NRF_SUCCESS == result ) { handling_notice ( HANDLING_NOTICE_STREAM, &(application->status), APPLICATION_EVENT_STREAM ); }
 
-  if ( NRF_SUCCESS == result ) { result = handling_register ( &(application->settings.handling.limit) ); }
+    }
+
+  // With every service in place, publish the database layout signature.
+
+  if ( NRF_SUCCESS == result ) { result = control_database ( ); }
 
   // Return with result.
 
@@ -204,16 +259,15 @@ unsigned application_nearfield ( application_t * application ) {
 
   if ( NRF_SUCCESS == result ) {
 
+    static unsigned char         tags [ APPLICATION_NDEF_LIMIT ];
     const void *              primary = control_uuid ( );
     const void *              control = access_uuid ( );
-    void *                       tags = malloc ( ndef_tags ( NULL, primary, control, node ) );
-    unsigned                     size = ndef_tags ( tags, primary, control, node );
 
-    if ( tags ) { result = nfct_data ( tags ); }
-    else { result = NRF_ERROR_NO_MEM; }
+    if ( ndef_tags ( NULL, primary, control, node ) <= sizeof(tags) ) { ndef_tags ( tags, primary, control, node ); }
+    else return ( NRF_ERROR_NO_MEM );
+
+    result = nfct_data ( tags );
 
-    free ( tags ); 
-    
     }
 
   // Return with result.
@@ -240,11 +294,12 @@ void application_starting ( application_t * application ) {
 
   status_start ( STATUS_UPDATE_INTERVAL );
 
-  // If the tracking window is open, start the beacon broadcast.
+  // If the tracking window is open, start the beacon broadcast at the
+  // cadence of the current state.
 
   if ( (application->settings.tracking.time.opened) && !(application->settings.tracking.time.closed) ) {
 
-    beacon_begin ( BEACON_BROADCAST_RATE, BEACON_BROADCAST_PERIOD, BEACON_BROADCAST_POWER, BEACON_TYPE_BLE_4 );
+    application_broadcast ( application );
 
     }
 
@@ -425,6 +480,10 @@ void application_attach ( application_t * application ) {
   sensors_begin ( TELEMETRY_SERVICE_INTERVAL, application->settings.telemetry.archival );
   movement_begin ( TELEMETRY_SERVICE_INTERVAL );
 
+  // Publish the current provisioning settings for bulk retrieval.
+
+  application_publish ( application );
+
   }
 
 //-----------------------------------------------------------------------------
@@ -467,7 +526,12 @@ void application_detach ( application_t * application ) {
 
     }
 
-  // Retrieve the settings values from the various telemetry services.
+  // Broadcast the tracking network node, which may have been changed.
+
+  beacon_network ( &(application->settings.tracking.node) );
+
+  // Retrieve the settings values from the various telemetry services. A
+  // service which was never registered leaves its settings untouched.
 
   surface_settings ( &(application->settings.surface.lower), &(application->settings.surface.upper) );
   handling_settings ( &(application->settings.handling.limit) );
@@ -483,11 +547,17 @@ void application_detach ( application_t * application ) {
   movement_limits ( application->settings.handling.limit.force, application->settings.handling.limit.angle );
   movement_begin ( application->settings.telemetry.interval );
 
-  // If the tracking window is open, activate the telemetry beacon.
+  // Any incident burst ended with the connection.
+
+  ctl_timer_clear ( &(application->status), APPLICATION_EVENT_SUBSIDE );
+  application->bursting               = false;
+
+  // If the tracking window is open, activate the telemetry beacon at the
+  // cadence of the current state.
 
   if ( application->settings.tracking.time.opened && !(application->settings.tracking.time.closed) ) {
 
-    beacon_begin ( BEACON_BROADCAST_RATE, BEACON_BROADCAST_PERIOD, BEACON_BROADCAST_POWER, BEACON_TYPE_BLE_4 );
+    application_broadcast ( application );
 
     } else { beacon_cease ( ); }
 
@@ -497,6 +567,102 @@ void application_detach ( application_t * application ) {
 
   }
 
+//-----------------------------------------------------------------------------
+//  function: application_cadence ( application )
+// arguments: application - application resource
+//
+// Adapt the rate and power of a running beacon to the state of the tag. The
+// beacon is quickened while the tag is moving or out of compliance and slowed
+// while it rests in compliance; a critical battery steps each cadence down a
+// level. A beacon which is not running is left alone, and an unchanged
+// cadence costs nothing, since the beacon only re-times on a change.
+//-----------------------------------------------------------------------------
+
+void application_cadence ( application_t * application ) {
+
+  bool                         active = false;
+
+  // Only a running beacon is re-timed, and an incident burst holds the
+  // cadence until it subsides.
+
+  if ( application->bursting ) return;
+  if ( NRF_SUCCESS != beacon_state ( &(active) ) || ! active ) return;
+
+  application_broadcast ( application );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: application_broadcast ( application )
+// arguments: application - application resource
+//
+// Begin (or re-time) the beacon at the cadence of the current movement,
+// compliance and battery state.
+//-----------------------------------------------------------------------------
+
+void application_broadcast ( application_t * application ) {
+
+  bool                         moving = false;
+
+  // Choose the cadence from the movement and compliance state.
+
+  movement_activity ( &(moving) );
+
+  if ( moving || application->excursion ) {
+
+    if ( status_check ( STATUS_BATTERY ) ) { beacon_begin ( BEACON_BROADCAST_RATE, BEACON_BROADCAST_PERIOD, BEACON_BROADCAST_POWER, BEACON_BROADCAST_TYPE ); }
+    else { beacon_begin ( BEACON_CADENCE_ALERT_RATE, BEACON_BROADCAST_PERIOD, BEACON_CADENCE_ALERT_POWER, BEACON_BROADCAST_TYPE ); }
+
+    } else {
+
+    if ( status_check ( STATUS_BATTERY ) ) { beacon_begin ( BEACON_CADENCE_SAVER_RATE, BEACON_BROADCAST_PERIOD, BEACON_CADENCE_SAVER_POWER, BEACON_BROADCAST_TYPE ); }
+    else { beacon_begin ( BEACON_CADENCE_QUIET_RATE, BEACON_BROADCAST_PERIOD, BEACON_CADENCE_QUIET_POWER, BEACON_BROADCAST_TYPE ); }
+
+    }
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: application_atmospheric ( application, atmosphere )
+// arguments: application - application resource
+//            atmosphere - atmospheric readings
+//
+// Track whether the atmosphere is currently outside its limits and adapt the
+// beacon cadence. As with the channel compliance, unset limits are ignored
+// and a reading that is not a number is never an excursion.
+//-----------------------------------------------------------------------------
+
+void application_atmospheric ( application_t * application, atmosphere_values_t * atmosphere ) {
+
+  application->excursion             &= ~(STATUS_AMBIENT | STATUS_HUMIDITY | STATUS_PRESSURE);
+
+  if ( (application->settings.atmosphere.lower.temperature < application->settings.atmosphere.upper.temperature) && ((atmosphere->temperature < application->settings.atmosphere.lower.temperature) || (atmosphere->temperature > application->settings.atmosphere.upper.temperature)) ) { application->excursion |= STATUS_AMBIENT; }
+  if ( (application->settings.atmosphere.lower.humidity < application->settings.atmosphere.upper.humidity) && ((atmosphere->humidity < application->settings.atmosphere.lower.humidity) || (atmosphere->humidity > application->settings.atmosphere.upper.humidity)) ) { application->excursion |= STATUS_HUMIDITY; }
+  if ( (application->settings.atmosphere.lower.pressure < application->settings.atmosphere.upper.pressure) && ((atmosphere->pressure < application->settings.atmosphere.lower.pressure) || (atmosphere->pressure > application->settings.atmosphere.upper.pressure)) ) { application->excursion |= STATUS_PRESSURE; }
+
+  application_cadence ( application );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: application_superficial ( application, temperature )
+// arguments: application - application resource
+//            temperature - surface temperature reading
+//
+// Track whether the surface is currently outside its limits (when set) and
+// adapt the beacon cadence.
+//-----------------------------------------------------------------------------
+
+void application_superficial ( application_t * application, float temperature ) {
+
+  application->excursion             &= ~(STATUS_SURFACE);
+
+  if ( (application->settings.surface.lower < application->settings.surface.upper) && ((temperature < application->settings.surface.lower) || (temperature > application->settings.surface.upper)) ) { application->excursion |= STATUS_SURFACE; }
+
+  application_cadence ( application );
+
+  }
+
 //-----------------------------------------------------------------------------
 //  function: application_probed ( application )
 // arguments: application - application resource
@@ -519,12 +685,141 @@ void application_probed ( application_t * application ) {
 
 void application_expire ( application_t * application ) {
 
-  // Request the NFC device after the advertisement expires.
+  bool                         linked = false;
+
+  // Request the NFC device after the advertisement expires, unless a peer is
+  // still linked (it will be requested when the last peer detaches).
 
+  if ( NRF_SUCCESS == peripheral_state ( NULL, &(linked) ) && linked ) return;
   if ( application->option & APPLICATION_OPTION_NFC ) { nfct_request ( ); }
 
   }
 
+//-----------------------------------------------------------------------------
+//  function: application_provision ( application )
+// arguments: application - application resource
+//
+// Respond to a bulk settings write. The control service has already checked
+// the blob, so every setting is taken over in one step: the services are
+// updated to match and the sensor and movement modules re-timed.
+//-----------------------------------------------------------------------------
+
+void application_provision ( application_t * application ) {
+
+  control_settings_t         settings;
+
+  if ( NRF_SUCCESS != control_provision ( &(settings) ) ) return;
+
+  // Take over the tracking node and, if one was written, the lock.
+
+  memcpy ( &(application->settings.tracking.node), &(settings.node), sizeof(hash_t) );
+
+  for ( unsigned n = 0; n < SOFTDEVICE_KEY_LENGTH; ++ n ) {
+    if ( settings.lock[ n ] ) { memcpy ( application->settings.tracking.lock, settings.lock, SOFTDEVICE_KEY_LENGTH ); break; }
+    }
+
+  beacon_network ( &(application->settings.tracking.node) );
+
+  // Take over the limits and intervals.
+
+  application->settings.surface.lower = settings.surface.lower;
+  application->settings.surface.upper = settings.surface.upper;
+
+  memcpy ( &(application->settings.atmosphere.lower), &(settings.atmosphere.lower), sizeof(atmosphere_values_t) );
+  memcpy ( &(application->settings.atmosphere.upper), &(settings.atmosphere.upper), sizeof(atmosphere_values_t) );
+  memcpy ( &(application->settings.handling.limit), &(settings.handling), sizeof(handling_values_t) );
+
+  application->settings.telemetry.interval = settings.telemetry.interval;
+  application->settings.telemetry.archival = settings.telemetry.archival;
+
+  // Bring the individual services into line so that they read back the new
+  // settings and are not reverted when the peer detaches.
+
+  surface_configure ( application->settings.surface.lower, application->settings.surface.upper );
+  atmosphere_configure ( &(application->settings.atmosphere.lower), &(application->settings.atmosphere.upper) );
+  handling_configure ( &(application->settings.handling.limit) );
+  telemetry_configure ( application->settings.telemetry.interval, application->settings.telemetry.archival );
+
+  // Apply the new limits and timing.
+
+  movement_limits ( application->settings.handling.limit.force, application->settings.handling.limit.angle );
+  sensors_adjust ( application->settings.telemetry.interval, application->settings.telemetry.archival );
+  movement_begin ( application->settings.telemetry.interval );
+
+  // Publish the settings back and mark them for saving.
+
+  application_publish ( application );
+  ctl_events_set ( &(application->status), APPLICATION_STATE_SETTINGS );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: application_located ( application )
+// arguments: application - application resource
+//
+// Respond to a location written by a gateway or reader. A new location is
+// broadcast by the beacon and, while the tracking window is open, logged to
+// the location archive; a repeat of the last known location is ignored. An
+// all-zero location clears the broadcast location and is not archived.
+//-----------------------------------------------------------------------------
+
+void application_located ( application_t * application ) {
+
+  control_location_t         location;
+  control_location_t            empty = { 0 };
+
+  if ( NRF_SUCCESS != control_location ( &(location) ) ) return;
+  if ( ! memcmp ( &(location), &(application->location), sizeof(control_location_t) ) ) return;
+
+  memcpy ( &(application->location), &(location), sizeof(control_location_t) );
+  beacon_location ( &(application->location) );
+
+  // A cleared location is not a location change worth archiving. Location
+  // changes are only archived while the tracking window is open and a UTC
+  // time has been established.
+
+  if ( ! memcmp ( &(location), &(empty), sizeof(control_location_t) ) ) return;
+
+  if ( application->settings.tracking.time.opened && ! application->settings.tracking.time.closed && ctl_time_get ( ) ) {
+
+    if ( NRF_SUCCESS == control_archive ( &(application->location) ) ) {
+      #ifdef DEBUG
+      debug_printf ( "\r\nArchive: location" );
+      #endif
+      }
+
+    }
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: application_publish ( application )
+// arguments: application - application resource
+//
+// Publish the provisioning subset of the settings through the control
+// service bulk settings characteristic.
+//-----------------------------------------------------------------------------
+
+void application_publish ( application_t * application ) {
+
+  control_settings_t         settings = { 0 };
+
+  memcpy ( &(settings.node), &(application->settings.tracking.node), sizeof(hash_t) );
+
+  settings.surface.lower              = application->settings.surface.lower;
+  settings.surface.upper              = application->settings.surface.upper;
+
+  memcpy ( &(settings.atmosphere.lower), &(application->settings.atmosphere.lower), sizeof(atmosphere_values_t) );
+  memcpy ( &(settings.atmosphere.upper), &(application->settings.atmosphere.upper), sizeof(atmosphere_values_t) );
+  memcpy ( &(settings.handling), &(application->settings.handling.limit), sizeof(handling_values_t) );
+
+  settings.telemetry.interval         = application->settings.telemetry.interval;
+  settings.telemetry.archival         = application->settings.telemetry.archival;
+
+  control_publish ( &(settings) );
+
+  }
+
 
 //=============================================================================
 // SECTION : PERIODIC TELEMETRY AND HANDLING EVENTS
@@ -569,12 +864,20 @@ void application_telemetry ( application_t * application ) {
 
         }
 
+      beacon_update_begin ( );
       beacon_ambient ( atmosphere.temperature, inside.temperature, outside.temperature );
       beacon_humidity ( atmosphere.humidity, inside.humidity, outside.humidity );
       beacon_pressure ( atmosphere.pressure, inside.pressure, outside.pressure );
+      beacon_schedule ( status_check ( STATUS_CONNECT ) ? TELEMETRY_SERVICE_INTERVAL : application->settings.telemetry.interval );
+      beacon_update_commit ( );
 
       }
 
+    // Track whether the atmosphere is currently outside its limits and adapt
+    // the beacon cadence.
+
+    application_atmospheric ( application, &(atmosphere) );
+
     #ifdef DEBUG
     debug_printf ( "\r\nTelemetry: %1.2fC %1.1f%% %1.3f bar", atmosphere.temperature, atmosphere.humidity * 100.0, atmosphere.pressure );
     #endif
@@ -618,6 +921,188 @@ void application_archive ( application_t * application ) {
 
   }
 
+//-----------------------------------------------------------------------------
+//  function: application_retimed ( application )
+// arguments: application - application resource
+//
+// Handle a notice that the peer has written new telemetry intervals. Adopt
+// the settings and re-time the sensor and movement modules immediately while
+// preserving the archive phase.
+//-----------------------------------------------------------------------------
+
+void application_retimed ( application_t * application ) {
+
+  if ( NRF_SUCCESS == telemetry_settings ( &(application->settings.telemetry.interval), &(application->settings.telemetry.archival) ) ) {
+
+    sensors_adjust ( application->settings.telemetry.interval, application->settings.telemetry.archival );
+    movement_begin ( application->settings.telemetry.interval );
+
+    // Keep the bulk settings in step and mark the settings for saving.
+
+    application_publish ( application );
+    ctl_events_set ( &(application->status), APPLICATION_STATE_SETTINGS );
+
+    }
+
+  }
+
+
+//=============================================================================
+// SECTION : ON-DEMAND MEASUREMENT EVENTS
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+//  function: application_measure ( application )
+// arguments: application - application resource
+//
+// Handle a measurement request from the peer. Each present module is asked
+// for an out of cycle measurement and the outstanding replies are noted. A
+// request made while one is still outstanding is folded into it.
+//-----------------------------------------------------------------------------
+
+void application_measure ( application_t * application ) {
+
+  if ( application->measuring ) return;
+
+  // Ask the sensor and movement modules for immediate readings. Their timers
+  // and the archive phase are left alone.
+
+  if ( application->option & (PLATFORM_OPTION_PRESSURE | PLATFORM_OPTION_HUMIDITY) ) {
+
+    if ( NRF_SUCCESS == sensors_measure ( ) ) { application->measuring |= APPLICATION_EVENT_AMBIENT; }
+
+    }
+
+  if ( application->option & PLATFORM_OPTION_MOTION ) {
+
+    if ( NRF_SUCCESS == movement_measure ( ) ) { application->measuring |= APPLICATION_EVENT_SURFACE; }
+
+    }
+
+  // With nothing to wait for, report the current values straight away.
+
+  if ( ! application->measuring ) { application_measured ( application ); }
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: application_ambient ( application )
+// arguments: application - application resource
+//
+// Handle a notice that the out of cycle sensor readings are ready. The
+// atmospheric service and beacon are brought up to date and the excursion
+// tracking and beacon cadence follow the new reading, but no time is accrued
+// against compliance since the reading falls outside the cycle (the next
+// cycle reading accrues the whole interval).
+//-----------------------------------------------------------------------------
+
+void application_ambient ( application_t * application ) {
+
+  atmosphere_values_t      atmosphere = { 0 };
+
+  if ( NRF_SUCCESS == sensors_atmosphere ( &(atmosphere.temperature), &(atmosphere.humidity), &(atmosphere.pressure) ) ) {
+
+    if ( NRF_SUCCESS == atmosphere_measured ( &(atmosphere), 0 ) ) {
+
+      atmosphere_compliance_t  inside = { 0 };
+      atmosphere_compliance_t outside = { 0 };
+
+      atmosphere_compliance ( &(inside), &(outside) );
+
+      beacon_update_begin ( );
+      beacon_ambient ( atmosphere.temperature, inside.temperature, outside.temperature );
+      beacon_humidity ( atmosphere.humidity, inside.humidity, outside.humidity );
+      beacon_pressure ( atmosphere.pressure, inside.pressure, outside.pressure );
+      beacon_update_commit ( );
+
+      }
+
+    // An out of cycle reading is tracked against the limits, and adapts the
+    // beacon cadence, just like a cycle reading.
+
+    application_atmospheric ( application, &(atmosphere) );
+
+    }
+
+  // Publish the combined result once the last module has reported.
+
+  if ( application->measuring & APPLICATION_EVENT_AMBIENT ) {
+
+    application->measuring           &= ~(APPLICATION_EVENT_AMBIENT);
+    if ( ! application->measuring ) { application_measured ( application ); }
+
+    }
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: application_surface ( application )
+// arguments: application - application resource
+//
+// Handle a notice that the out of cycle surface temperature is ready. As
+// with the ambient readings, no time is accrued against compliance.
+//-----------------------------------------------------------------------------
+
+void application_surface ( application_t * application ) {
+
+  float                   temperature = 0;
+
+  if ( NRF_SUCCESS == movement_temperature ( &(temperature) ) ) {
+
+    if ( NRF_SUCCESS == surface_measured ( temperature, 0 ) ) {
+
+      surface_compliance_t     inside = 0;
+      surface_compliance_t    outside = 0;
+
+      surface_compliance ( &(inside), &(outside) );
+
+      beacon_temperature ( temperature, inside, outside );
+
+      }
+
+    application_superficial ( application, temperature );
+
+    }
+
+  // Publish the combined result once the last module has reported.
+
+  if ( application->measuring & APPLICATION_EVENT_SURFACE ) {
+
+    application->measuring           &= ~(APPLICATION_EVENT_SURFACE);
+    if ( ! application->measuring ) { application_measured ( application ); }
+
+    }
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: application_measured ( application )
+// arguments: application - application resource
+//
+// Publish the combined on-demand measurement through the control service.
+//-----------------------------------------------------------------------------
+
+void application_measured ( application_t * application ) {
+
+  control_measurement_t   measurement = { .time = ctl_time_get ( ) };
+
+  if ( application->option & (PLATFORM_OPTION_PRESSURE | PLATFORM_OPTION_HUMIDITY) ) {
+
+    sensors_atmosphere ( &(measurement.atmosphere.temperature), &(measurement.atmosphere.humidity), &(measurement.atmosphere.pressure) );
+
+    }
+
+  if ( application->option & PLATFORM_OPTION_MOTION ) { movement_temperature ( &(measurement.surface) ); }
+
+  control_measurement ( &(measurement) );
+
+  #ifdef DEBUG
+  debug_printf ( "\r\nMeasured: %1.2fC %1.2fC %1.1f%% %1.3f bar", measurement.surface, measurement.atmosphere.temperature,
+                 measurement.atmosphere.humidity * 100.0, measurement.atmosphere.pressure );
+  #endif
+
+  }
+
 
 //=============================================================================
 // SECTION : MOVEMENT RELATED EVENTS
@@ -645,6 +1130,11 @@ void application_handling ( application_t * application ) {
 
     }
 
+  // Hold the beacon rebuild until both the orientation and the surface
+  // temperature records have been updated.
+
+  beacon_update_begin ( );
+
   // Capture the motion values and update the handling service characteristics.
 
   if ( (NRF_SUCCESS == movement_angles ( &(handling.angle), &(handling.face) ))
@@ -679,12 +1169,19 @@ void application_handling ( application_t * application ) {
       
       }
 
+    // Track whether the surface is currently outside its limits and adapt
+    // the beacon cadence.
+
+    application_superficial ( application, temperature );
+
     #ifdef DEBUG
     debug_printf ( "\r\n  Surface: %1.2fC", temperature );
     #endif
 
     }
 
+  beacon_update_commit ( );
+
   }
 
 //-----------------------------------------------------------------------------
@@ -707,11 +1204,61 @@ void application_oriented ( application_t * application ) {
 
   }
 
+//-----------------------------------------------------------------------------
+//  function: application_stream ( application )
+// arguments: application - application resource
+//
+// Handle a notice that the raw motion stream subscription has changed. Start
+// the movement sample stream sized to the peer's batch, or stop it.
+//-----------------------------------------------------------------------------
+
+void application_stream ( application_t * application ) {
+
+  unsigned                      batch = 0;
+
+  if ( NRF_SUCCESS == handling_streaming ( &(batch) ) ) { movement_stream ( batch ); }
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: application_samples ( application )
+// arguments: application - application resource
+//
+// Handle a notice that raw motion samples are waiting. Drain whole batches
+// from the movement module and notify each one through the handling service.
+//-----------------------------------------------------------------------------
+
+void application_samples ( application_t * application ) {
+
+  movement_sample_t           samples [ HANDLING_STREAM_BATCH ];
+  unsigned                      batch = 0;
+
+  // Stop the movement stream if the peer is no longer subscribed.
+
+  if ( (NRF_SUCCESS != handling_streaming ( &(batch) )) || ! batch ) { movement_stream ( 0 ); return; }
+  if ( batch > HANDLING_STREAM_BATCH ) { batch = HANDLING_STREAM_BATCH; }
+
+  forever {
+
+    unsigned                    count = batch;
+
+    if ( NRF_SUCCESS != movement_samples ( samples, &(count) ) ) break;
+    if ( NRF_SUCCESS != handling_stream ( samples, count ) ) break;
+    if ( count < batch ) break;
+
+    }
+
+  }
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 
 void application_stressed ( application_t * application ) {
 
+  application->incident.bumped       += 1;
+
+  if ( NRF_SUCCESS == beacon_bumped ( ) ) { application_burst ( application ); }
+
   }
 
 //-----------------------------------------------------------------------------
@@ -719,6 +1266,10 @@ void application_stressed ( application_t * application ) {
 
 void application_dropped ( application_t * application ) {
 
+  application->incident.dropped      += 1;
+
+  if ( NRF_SUCCESS == beacon_dropped ( ) ) { application_burst ( application ); }
+
   }
 
 //-----------------------------------------------------------------------------
@@ -726,4 +1277,49 @@ void application_dropped ( application_t * application ) {
 
 void application_tilted ( application_t * application ) {
 
+  application->incident.tipped       += 1;
+
+  if ( NRF_SUCCESS == beacon_tipped ( ) ) { application_burst ( application ); }
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: application_burst ( application )
+// arguments: application - application resource
+//
+// Advertise a freshly flagged incident at the burst rate. A further incident
+// during the burst extends it. A beacon which is not running is left alone.
+//-----------------------------------------------------------------------------
+
+void application_burst ( application_t * application ) {
+
+  bool                         active = false;
+
+  if ( NRF_SUCCESS != beacon_state ( &(active) ) || ! active ) return;
+
+  if ( NRF_SUCCESS == beacon_begin ( BEACON_BURST_RATE, BEACON_BROADCAST_PERIOD, BEACON_BURST_POWER, BEACON_BROADCAST_TYPE ) ) {
+
+    application->bursting             = true;
+
+    ctl_timer_clear ( &(application->status), APPLICATION_EVENT_SUBSIDE );
+    ctl_timer_start ( CTL_TIMER_NONCYCLICAL, &(application->status), APPLICATION_EVENT_SUBSIDE, (CTL_TIME_t) roundf ( BEACON_BURST_DURATION * 1000.0 ) );
+
+    }
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: application_subside ( application )
+// arguments: application - application resource
+//
+// The incident burst has run its course, so fall back to the cadence.
+//-----------------------------------------------------------------------------
+
+void application_subside ( application_t * application ) {
+
+  ctl_timer_clear ( &(application->status), APPLICATION_EVENT_SUBSIDE );
+
+  application->bursting               = false;
+  application_cadence ( application );
+
   }
@@ -65,6 +65,11 @@ typedef   struct {
 
             } incident;
 
+          CTL_EVENT_SET_t             measuring;                                // Outstanding on-demand measurements
+          unsigned                    excursion;                                // Sensors currently outside their limits
+          bool                        bursting;                                 // Beacon incident burst in progress
+          control_location_t          location;                                 // Last known location (RAM only)
+
           } application_t;
 
           void                        main ( application_t * application );
@@ -124,6 +129,8 @@ typedef   struct {
 #define   APPLICATION_OPTION_BLE      (1 << 31)                                 // Bluetooth low energy radio
 #define   APPLICATION_OPTION_NFC      (1 << 30)                                 // Near field radio
 
+#define   APPLICATION_NDEF_LIMIT      (256)                                     // NFC tag content buffer size in bytes
+
 //-----------------------------------------------------------------------------
 // Interactive events.
 //-----------------------------------------------------------------------------
@@ -139,6 +146,13 @@ typedef   struct {
 
           void                        application_advertise ( application_t * application );
 
+#define   APPLICATION_EVENT_CADENCE   (1 << 5)                                  // Movement started or stopped
+
+          void                        application_cadence ( application_t * application );
+          void                        application_broadcast ( application_t * application );
+          void                        application_atmospheric ( application_t * application, atmosphere_values_t * atmosphere );
+          void                        application_superficial ( application_t * application, float temperature );
+
 #define   APPLICATION_EVENT_ATTACH    (1 << 23)                                 // BLE peripheral has attached
 #define   APPLICATION_EVENT_DETACH    (1 << 22)                                 // BLE connection has detached
 #define   APPLICATION_EVENT_PROBED    (1 << 21)                                 // Scan response has been probed
@@ -149,6 +163,15 @@ typedef   struct {
           void                        application_probed ( application_t * application );
           void                        application_expire ( application_t * application );
 
+#define   APPLICATION_EVENT_PROVISION (1 << 9)                                  // Bulk settings written by the peer
+
+          void                        application_provision ( application_t * application );
+          void                        application_publish ( application_t * application );
+
+#define   APPLICATION_EVENT_LOCATED   (1 << 3)                                  // Location written by a gateway or reader
+
+          void                        application_located ( application_t * application );
+
 //-----------------------------------------------------------------------------
 // Periodic telemetry updates
 //-----------------------------------------------------------------------------
@@ -159,6 +182,25 @@ typedef   struct {
           void                        application_telemetry ( application_t * application );
           void                        application_archive ( application_t * application );
 
+#define   APPLICATION_EVENT_RETIMED   (1 << 10)                                 // Telemetry intervals reconfigured
+
+          void                        application_retimed ( application_t * application );
+
+//-----------------------------------------------------------------------------
+// On-demand measurement events. A peer request starts an out of cycle
+// measurement in each module; the combined result is published once every
+// module has reported back.
+//-----------------------------------------------------------------------------
+
+#define   APPLICATION_EVENT_MEASURE   (1 << 8)                                  // Measurement requested by the peer
+#define   APPLICATION_EVENT_AMBIENT   (1 << 7)                                  // Out of cycle sensor readings ready
+#define   APPLICATION_EVENT_SURFACE   (1 << 6)                                  // Out of cycle surface reading ready
+
+          void                        application_measure ( application_t * application );
+          void                        application_ambient ( application_t * application );
+          void                        application_surface ( application_t * application );
+          void                        application_measured ( application_t * application );
+
 //-----------------------------------------------------------------------------
 // Movement related events
 //-----------------------------------------------------------------------------
@@ -169,6 +211,16 @@ typedef   struct {
           void                        application_handling ( application_t * application );
           void                        application_oriented ( application_t * application );
 
+//-----------------------------------------------------------------------------
+// Raw motion stream events
+//-----------------------------------------------------------------------------
+
+#define   APPLICATION_EVENT_STREAM    (1 << 19)                                 // Stream subscription changed
+#define   APPLICATION_EVENT_SAMPLES   (1 << 18)                                 // Raw sample batch available
+
+          void                        application_stream ( application_t * application );
+          void                        application_samples ( application_t * application );
+
 //-----------------------------------------------------------------------------
 // Incident handling
 //-----------------------------------------------------------------------------
@@ -181,5 +233,10 @@ typedef   struct {
           void                        application_dropped ( application_t * application );
           void                        application_tilted ( application_t * application );
 
+#define   APPLICATION_EVENT_SUBSIDE   (1 << 4)                                  // Incident burst has run its course
+
+          void                        application_burst ( application_t * application );
+          void                        application_subside ( application_t * application );
+
 //=============================================================================
 #endif
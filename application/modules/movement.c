@@ -150,6 +150,53 @@ unsigned movement_notice ( movement_notice_t notice, CTL_EVENT_SET_t * set, CTL_
 
   }
 
+//-----------------------------------------------------------------------------
+//  function: movement_measure ( )
+// arguments: none
+//   returns: NRF_SUCCESS - if requested
+//            NRF_ERROR_INVALID_STATE - if the module has not been started
+//
+// Request an immediate, out of cycle surface temperature reading from the
+// motion sensor. The measured notice is issued once the reading is taken.
+// The periodic timer is left undisturbed.
+//-----------------------------------------------------------------------------
+
+unsigned movement_measure ( void ) {
+
+  movement_t *               movement = &(resource);
+
+  // Make sure that the module has been started.
+
+  if ( thread ) { ctl_events_set ( &(movement->status), MOVEMENT_EVENT_MEASURE ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  return ( NRF_SUCCESS );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: movement_activity ( active )
+// arguments: active - set true if movement is currently under way
+//   returns: NRF_SUCCESS - if retrieved
+//            NRF_ERROR_INVALID_STATE - if the module has not been started
+//
+// Retrieve the movement activity state. The started and stopped notices are
+// issued as it changes.
+//-----------------------------------------------------------------------------
+
+unsigned movement_activity ( bool * active ) {
+
+  movement_t *               movement = &(resource);
+
+  // Make sure that the module has been started.
+
+  if ( thread ) { if ( active ) *(active) = (movement->status & MOVEMENT_STATE_ACTIVITY) ? true : false; }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  return ( NRF_SUCCESS );
+
+  }
+
 //-----------------------------------------------------------------------------
 // Retrieve the temperature from the motion sensor.
 //-----------------------------------------------------------------------------
@@ -228,6 +275,86 @@ unsigned movement_angles ( float * angle, char * orientation ) {
 
   }
 
+//-----------------------------------------------------------------------------
+//  function: movement_stream ( batch )
+// arguments: batch - number of samples per batch (0 to stop the stream)
+//   returns: NRF_SUCCESS - if the stream was started or stopped
+//            NRF_ERROR_INVALID_STATE - if the module has not been started
+//
+// Start or stop the raw motion sample stream. Starting the stream discards
+// any stale samples left in the ring.
+//-----------------------------------------------------------------------------
+
+unsigned movement_stream ( unsigned batch ) {
+
+  movement_t *               movement = &(resource);
+  unsigned                     result = NRF_SUCCESS;
+
+  // Make sure that the module has been started.
+
+  if ( thread ) { ctl_mutex_lock_uc ( &(movement->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  // Limit the batch to half of the ring so that the producer can keep filling
+  // while the consumer drains a batch.
+
+  if ( batch > (MOVEMENT_STREAM_DEPTH / 2) ) { batch = (MOVEMENT_STREAM_DEPTH / 2); }
+
+  if ( (movement->stream.batch = batch) ) {
+
+    movement->stream.tail             = movement->stream.head;
+    movement->stream.dropped          = 0;
+
+    ctl_events_set ( &(movement->status), MOVEMENT_STATE_STREAM );
+
+    } else { ctl_events_clear ( &(movement->status), MOVEMENT_STATE_STREAM ); }
+
+  // Free the resource and return with result.
+
+  return ( ctl_mutex_unlock ( &(movement->mutex) ), result );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: movement_samples ( samples, count )
+// arguments: samples - buffer to receive the raw samples
+//            count - buffer capacity on input, samples retrieved on return
+//   returns: NRF_SUCCESS - if samples were retrieved
+//            NRF_ERROR_NOT_FOUND - if no samples are queued
+//            NRF_ERROR_NULL - if parameters are missing
+//
+// Drain queued raw motion samples from the stream ring. This does not take the
+// module mutex: the ring has a single producer (the manager thread) and must
+// have a single consumer.
+//-----------------------------------------------------------------------------
+
+unsigned movement_samples ( movement_sample_t * samples, unsigned * count ) {
+
+  movement_t *               movement = &(resource);
+  unsigned                       tail = movement->stream.tail;
+  unsigned                       fill = movement->stream.head - tail;
+  unsigned                      index;
+
+  if ( ! (samples && count) ) return ( NRF_ERROR_NULL );
+
+  // Copy out as many samples as are queued and fit within the buffer.
+
+  if ( fill > *(count) ) { fill = *(count); }
+
+  for ( index = 0; index < fill; ++ index ) { samples[ index ] = movement->stream.ring[ (tail + index) & MOVEMENT_STREAM_MASK ]; }
+
+  // Release the ring slots only after the samples have been copied.
+
+  __DMB ( );
+
+  movement->stream.tail               = tail + fill;
+
+  // Return with the number of samples retrieved.
+
+  return ( (*(count) = fill) ? NRF_SUCCESS : NRF_ERROR_NOT_FOUND );
+
+  }
+
 //-----------------------------------------------------------------------------
 // Set the alarm limits for movement
 //-----------------------------------------------------------------------------
@@ -278,6 +405,7 @@ static void movement_manager ( movement_t * movement ) {
     // Respond to the periodic event.
 
     if ( status & MOVEMENT_EVENT_PERIODIC ) { movement_periodic ( movement ); }
+    if ( status & MOVEMENT_EVENT_MEASURE ) { movement_immediate ( movement ); }
 
     // Respond to motion sensor events.
 
@@ -406,6 +534,21 @@ static void movement_periodic ( movement_t * movement ) {
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 
+static void movement_immediate ( movement_t * movement ) {
+
+  // Retrieve a fresh temperature reading from the motion sensor and issue a
+  // measured notice, even if the reading failed, so that nobody is kept
+  // waiting.
+
+  motion_temperature ( &(movement->temperature) );
+
+  ctl_notice ( movement->notice + MOVEMENT_NOTICE_MEASURED );
+
+  }
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
 static void movement_orientation ( movement_t * movement ) {
 
   if ( NRF_SUCCESS == motion_orientation ( &(movement->orientation) ) ) { ctl_notice ( movement->notice + MOVEMENT_NOTICE_ORIENTATION ); }
@@ -467,6 +610,68 @@ static void __attribute__ (( optimize(2) )) movement_vectors ( movement_t * move
 
   ctl_events_set ( &(movement->status), MOVEMENT_STATE_VECTORS );
 
+  // If the raw sample stream is enabled, queue the sample.
+
+  if ( movement->status & MOVEMENT_STATE_STREAM ) { movement_enqueue ( movement ); }
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: movement_enqueue ( movement )
+// arguments: movement - module resource
+//   returns: nothing
+//
+// Quantize the latest vectors into the raw sample ring and issue a notice each
+// time another full batch becomes available. If the consumer has fallen behind
+// and the ring is full, the sample is dropped.
+//-----------------------------------------------------------------------------
+
+static void __attribute__ (( optimize(2) )) movement_enqueue ( movement_t * movement ) {
+
+  unsigned                       head = movement->stream.head;
+  unsigned                       fill = head - movement->stream.tail;
+  movement_sample_t *          sample = movement->stream.ring + (head & MOVEMENT_STREAM_MASK);
+
+  if ( fill < MOVEMENT_STREAM_DEPTH ) {
+
+    sample->linear[ 0 ]               = movement_quantize ( movement->vectors.linear.x, MOVEMENT_LINEAR_SCALE );
+    sample->linear[ 1 ]               = movement_quantize ( movement->vectors.linear.y, MOVEMENT_LINEAR_SCALE );
+    sample->linear[ 2 ]               = movement_quantize ( movement->vectors.linear.z, MOVEMENT_LINEAR_SCALE );
+
+    sample->angular[ 0 ]              = movement_quantize ( movement->vectors.angular.x, MOVEMENT_ANGULAR_SCALE );
+    sample->angular[ 1 ]              = movement_quantize ( movement->vectors.angular.y, MOVEMENT_ANGULAR_SCALE );
+    sample->angular[ 2 ]              = movement_quantize ( movement->vectors.angular.z, MOVEMENT_ANGULAR_SCALE );
+
+    } else { movement->stream.dropped += 1; return; }
+
+  // Publish the sample only after it has been written.
+
+  __DMB ( );
+
+  movement->stream.head               = head + 1;
+
+  // Issue a notice whenever a whole batch is waiting.
+
+  if ( movement->stream.batch && (((fill + 1) % movement->stream.batch) == 0) ) { ctl_notice ( movement->notice + MOVEMENT_NOTICE_SAMPLES ); }
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: movement_quantize ( value, scale )
+// arguments: value - measured value
+//            scale - quantization scale (LSB per unit)
+//   returns: saturated 16-bit quantized value
+//-----------------------------------------------------------------------------
+
+static signed short movement_quantize ( float value, float scale ) {
+
+  float                        scaled = value * scale;
+
+  if ( scaled > 32767.0 ) return ( 32767 );
+  if ( scaled < -32768.0 ) return ( -32768 );
+
+  return ( (signed short) lroundf ( scaled ) );
+
   }
 
 //-----------------------------------------------------------------------------
@@ -474,8 +679,12 @@ static void __attribute__ (( optimize(2) )) movement_vectors ( movement_t * move
 
 static void movement_active ( movement_t * movement ) {
 
+  bool                        started = (movement->status & MOVEMENT_STATE_ACTIVITY) ? false : true;
+
   ctl_events_set ( &(movement->status), MOVEMENT_STATE_ACTIVITY );
 
+  if ( started ) { ctl_notice ( movement->notice + MOVEMENT_NOTICE_STARTED ); }
+
   }
 
 //-----------------------------------------------------------------------------
@@ -483,6 +692,10 @@ static void movement_active ( movement_t * movement ) {
 
 static void movement_asleep ( movement_t * movement ) {
 
+  bool                        stopped = (movement->status & MOVEMENT_STATE_ACTIVITY) ? true : false;
+
   ctl_events_clear ( &(movement->status), MOVEMENT_STATE_ACTIVITY  );
 
+  if ( stopped ) { ctl_notice ( movement->notice + MOVEMENT_NOTICE_STOPPED ); }
+
   }
\ No newline at end of file
@@ -18,6 +18,14 @@
 
 #define   MOVEMENT_CLOSE_TIMEOUT       1000
 
+//-----------------------------------------------------------------------------
+// Raw sample ring. The depth must be a power of two. The ring is filled by the
+// manager thread and drained by the consumer without locking.
+//-----------------------------------------------------------------------------
+
+#define   MOVEMENT_STREAM_DEPTH       64                                        // Raw sample ring depth (power of two)
+#define   MOVEMENT_STREAM_MASK        (MOVEMENT_STREAM_DEPTH - 1)
+
 //-----------------------------------------------------------------------------
 // Telemetry manager resource
 //-----------------------------------------------------------------------------
@@ -52,6 +60,14 @@ typedef   struct {
 
           unsigned char               orientation;                              // Orientation face
 
+          struct {                                                              // Raw sample stream:
+            volatile unsigned         head;                                     //  Producer index
+            volatile unsigned         tail;                                     //  Consumer index
+            volatile unsigned         batch;                                    //  Samples per batch (0 = off)
+            unsigned                  dropped;                                  //  Samples dropped on overflow
+            movement_sample_t         ring [ MOVEMENT_STREAM_DEPTH ];           //  Sample ring
+            } stream;
+
           } movement_t;
 
 static    void                        movement_manager ( movement_t * movement );
@@ -74,6 +90,7 @@ static    void                        movement_standby ( movement_t * movement )
 #define   MOVEMENT_STATE_ACTIVITY     (1 << 27)                                 // Movement has occurred
 #define   MOVEMENT_STATE_FREEFALL     (1 << 26)                                 // Free fall detected
 #define   MOVEMENT_STATE_VECTORS      (1 << 25)                                 // Valid vectors available
+#define   MOVEMENT_STATE_STREAM       (1 << 24)                                 // Raw sample stream enabled
 
 //-----------------------------------------------------------------------------
 // Periodic movement and orientation updates
@@ -83,6 +100,14 @@ static    void                        movement_standby ( movement_t * movement )
 
 static    void                        movement_periodic ( movement_t * movement );
 
+//-----------------------------------------------------------------------------
+// Out of cycle surface temperature measurement
+//-----------------------------------------------------------------------------
+
+#define   MOVEMENT_EVENT_MEASURE      (1 << 9)
+
+static    void                        movement_immediate ( movement_t * movement );
+
 //-----------------------------------------------------------------------------
 // Movement events events
 //-----------------------------------------------------------------------------
@@ -94,6 +119,8 @@ static    void                        movement_periodic ( movement_t * movement
 static    void                        movement_orientation ( movement_t * movement );
 static    void                        movement_freefall ( movement_t * movement );
 static    void                        movement_vectors ( movement_t * movement );
+static    void                        movement_enqueue ( movement_t * movement );
+static    signed short                movement_quantize ( float value, float scale );
 
 #define   MOVEMENT_EVENT_ACTIVE       (1 << 11)
 #define   MOVEMENT_EVENT_ASLEEP       (1 << 10)
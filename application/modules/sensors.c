@@ -80,6 +80,51 @@ unsigned sensors_begin ( float interval, float archival ) {
 
   }
 
+//-----------------------------------------------------------------------------
+//  function: sensors_adjust ( interval, archival )
+// arguments: interval - measurement interval (seconds)
+//            archival - archive interval (seconds, 0 = off)
+//   returns: NRF_SUCCESS - if adjusted
+//            NRF_ERROR_INVALID_PARAM - if the interval is too short
+//            NRF_ERROR_INVALID_STATE - if the module has not been started
+//
+// Re-time running telemetry without disturbing the archive phase. Unlike
+// sensors_begin ( ), the time elapsed within the current archive window is
+// carried over so that the next archive record falls due on schedule.
+//-----------------------------------------------------------------------------
+
+unsigned sensors_adjust ( float interval, float archival ) {
+
+  sensors_t *                 sensors = &(resource);
+  CTL_TIME_t                   period = (CTL_TIME_t) roundf ( interval * 1000.0 );
+  CTL_TIME_t                   window = (CTL_TIME_t) roundf ( archival * 1000.0 );
+  unsigned                     result = NRF_SUCCESS;
+
+  // Make sure that the module has been started.
+
+  if ( thread ) { ctl_mutex_lock_uc ( &(sensors->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  // Update the period and window, keeping the elapsed archive time, and
+  // request a settings refresh to re-start the timer with the new period.
+
+  if ( period >= (CTL_TIME_t) (SENSORS_PERIOD_MINIMUM * 1000.0) ) {
+
+    if ( (sensors->archive.window = window) ) { sensors->archive.elapse = sensors->archive.elapse % window; }
+    else { sensors->archive.elapse = (CTL_TIME_t) 0; }
+
+    sensors->period                   = period;
+
+    ctl_events_set_clear ( &(sensors->status), SENSORS_EVENT_SETTINGS, SENSORS_EVENT_PERIODIC );
+
+    } else { result = NRF_ERROR_INVALID_PARAM; }
+
+  // Free the resource and return with the result.
+
+  return ( ctl_mutex_unlock ( &(sensors->mutex) ), result );
+
+  }
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 
@@ -130,6 +175,30 @@ unsigned sensors_close ( void ) {
 
   }
 
+//-----------------------------------------------------------------------------
+//  function: sensors_measure ( )
+// arguments: none
+//   returns: NRF_SUCCESS - if requested
+//            NRF_ERROR_INVALID_STATE - if the module has not been started
+//
+// Request an immediate, out of cycle measurement of every sensor. The
+// measured notice is issued once the readings are available. The periodic
+// timer and the archive window are left undisturbed.
+//-----------------------------------------------------------------------------
+
+unsigned sensors_measure ( void ) {
+
+  sensors_t *                 sensors = &(resource);
+
+  // Make sure that the module has been started.
+
+  if ( thread ) { ctl_events_set ( &(sensors->status), SENSORS_EVENT_MEASURE ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  return ( NRF_SUCCESS );
+
+  }
+
 //-----------------------------------------------------------------------------
 //  function: sensors_notice ( notice, set, events )
 // arguments: notice - the notice index to enable or disable
@@ -275,9 +344,10 @@ static void sensors_manager ( sensors_t * sensors ) {
     if ( status & SENSORS_EVENT_SETTINGS ) { sensors_settings ( sensors ); }
     if ( status & SENSORS_EVENT_STANDBY ) { sensors_standby ( sensors ); }
 
-    // Respond to the periodic event.
+    // Respond to the periodic and out of cycle measurement events.
 
     if ( status & SENSORS_EVENT_PERIODIC ) { sensors_periodic ( sensors ); }
+    if ( status & SENSORS_EVENT_MEASURE ) { sensors_immediate ( sensors ); }
 
     }
 
@@ -327,6 +397,44 @@ static void sensors_standby ( sensors_t * sensors ) {
 
 static void sensors_periodic ( sensors_t * sensors ) {
 
+  // Take the readings and issue a telemetry update notice.
+
+  sensors_sample ( sensors );
+
+  ctl_notice ( sensors->notice + SENSORS_NOTICE_TELEMETRY );
+
+  // If there is an established archive window and the window has elapsed,
+  // issue an archival event.
+
+  if ( sensors->archive.window ) {
+
+    sensors->archive.elapse           = sensors->archive.elapse + sensors->period;
+    if ( sensors->archive.elapse >= sensors->archive.window ) { ctl_notice ( sensors->notice + SENSORS_NOTICE_ARCHIVE ); }
+    sensors->archive.elapse           = sensors->archive.elapse % sensors->archive.window;
+
+    }
+
+  }
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+static void sensors_immediate ( sensors_t * sensors ) {
+
+  // Take the readings and issue a measured notice. The archive window does
+  // not advance.
+
+  sensors_sample ( sensors );
+
+  ctl_notice ( sensors->notice + SENSORS_NOTICE_MEASURED );
+
+  }
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+static void sensors_sample ( sensors_t * sensors ) {
+
   // Start by reading the CPU core die temperature as the internal temperature.
 
   if ( NRF_SUCCESS == softdevice_temperature ( &(sensors->internal.temperature) ) ) { sensors->status |= (SENSORS_VALUE_INTERNAL); }
@@ -369,19 +477,4 @@ static void sensors_periodic ( sensors_t * sensors ) {
 
     }
 
-  // Issue a telemetry update notice
-
-  ctl_notice ( sensors->notice + SENSORS_NOTICE_TELEMETRY );
-
-  // If there is an established archive window and the window has elapsed,
-  // issue an archival event.
-
-  if ( sensors->archive.window ) {
-
-    sensors->archive.elapse           = sensors->archive.elapse + sensors->period;
-    if ( sensors->archive.elapse >= sensors->archive.window ) { ctl_notice ( sensors->notice + SENSORS_NOTICE_ARCHIVE ); }
-    sensors->archive.elapse           = sensors->archive.elapse % sensors->archive.window;
-
-    }
-
   }
@@ -92,6 +92,16 @@ static    void                        sensors_standby ( sensors_t * sensors );
 #define   SENSORS_EVENT_PERIODIC      (1 << 15)
 
 static    void                        sensors_periodic ( sensors_t * sensors );
+static    void                        sensors_sample ( sensors_t * sensors );
+
+//-----------------------------------------------------------------------------
+// Out of cycle measurements are taken without touching the periodic timer or
+// the archive window.
+//-----------------------------------------------------------------------------
+
+#define   SENSORS_EVENT_MEASURE       (1 << 14)
+
+static    void                        sensors_immediate ( sensors_t * sensors );
 
 //=============================================================================
 #endif
@@ -0,0 +1,530 @@
+//=============================================================================
+// project: ShockVx
+//  module: Stickershock firmware for cold chain tracking.
+//  author: Velvetwire, llc
+//    file: channel.c
+//
+// Measured channel telemetry and settings service engine.
+//
+// (c) Copyright 2016-2020 Velvetwire, LLC. All rights reserved.
+//=============================================================================
+
+#include  <stickershock.h>
+
+#include  "bluetooth.h"
+#include  "gatt.h"
+#include  "channel.h"
+
+//=============================================================================
+// SECTION : SERVICE RESOURCE
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+// Declare the channel descriptors. Adding a measured channel only requires a
+// new channel type and its descriptor entry.
+//-----------------------------------------------------------------------------
+
+static    const channel_descriptor_t  descriptors [ CHANNELS ] = {
+
+  [ CHANNEL_SURFACE ]    = { .identity = CHANNEL_SURFACE_UUID, .fields = 1,
+                             .scale = { 1e2 },
+                             .archive = CHANNEL_SURFACE_ARCHIVE },
+
+  [ CHANNEL_ATMOSPHERE ] = { .identity = CHANNEL_ATMOSPHERE_UUID, .fields = 3,
+                             .scale = { 1e2, 1e4, 1e3 },
+                             .archive = CHANNEL_ATMOSPHERE_ARCHIVE },
+
+  };
+
+//-----------------------------------------------------------------------------
+// Declare the service class resource area for each channel.
+//-----------------------------------------------------------------------------
+
+static    channel_t                   resource [ CHANNELS ] = { 0 };
+
+//-----------------------------------------------------------------------------
+//  function: channel_uuid ( channel )
+// arguments: channel - measured channel
+//   returns: the 128-bit service UUID
+//
+// Retrieve the UUID for the channel service class.
+//-----------------------------------------------------------------------------
+
+const void * channel_uuid ( channel_type_t channel ) {
+
+  if ( channel < CHANNELS ) { return ( uuid ( &(resource[ channel ].id), descriptors[ channel ].identity ) ); }
+  else return ( NULL );
+
+  }
+
+
+//=============================================================================
+// SECTION : SERVICE CLASS
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+//  function: channel_register ( channel, lower, upper )
+// arguments: channel - measured channel
+//            lower - lower limits (NULL for none)
+//            upper - upper limits (NULL for none)
+//   returns: NRF_ERROR_RESOURCES if no resources available
+//            NRF_ERROR_INVALID_STATE if already registered
+//            NRF_SUCCESS if registered
+//
+// Build the characteristic table for the channel from its descriptor and
+// register the channel GATT service with the Bluetooth stack.
+//-----------------------------------------------------------------------------
+
+unsigned channel_register ( channel_type_t channel, const float * lower, const float * upper ) {
+
+  if ( channel >= CHANNELS ) return ( NRF_ERROR_INVALID_PARAM );
+
+  channel_t *                 service = &(resource[ channel ]);
+  const channel_descriptor_t * layout = &(descriptors[ channel ]);
+  unsigned short                 size = layout->fields * sizeof(float);
+  unsigned                     prefix = layout->identity & 0xFFFF0000;
+  unsigned                     result = NRF_SUCCESS;
+
+  // Initialize the service resource.
+
+  if ( service->gatt.service == BLE_GATT_HANDLE_INVALID ) { ctl_mutex_init ( &(service->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  service->descriptor                 = layout;
+
+  if ( lower ) { memcpy ( service->value.lower, lower, size ); }
+  if ( upper ) { memcpy ( service->value.upper, upper, size ); }
+
+  // Build the characteristic table, sized to the channel values.
+
+  service->table[ CHANNEL_ENTRY_VALUE ] = (gatt_characteristic_t) {
+    .uuid = prefix | CHANNEL_VALUE_UUID, .attributes = BLE_ATTR_NOTIFY | BLE_ATTR_READ, .link = CHANNEL_LINK_VALUE, .options = GATT_OPTION_RESIDENT,
+    .length = size, .limit = size, .value = service->value.value, .handles = &(service->handle.value) };
+  service->table[ CHANNEL_ENTRY_LOWER ] = (gatt_characteristic_t) {
+    .uuid = prefix | CHANNEL_LOWER_UUID, .attributes = BLE_ATTR_PROTECTED | BLE_ATTR_WRITE | BLE_ATTR_READ,
+    .length = size, .limit = size, .value = service->value.lower, .handles = &(service->handle.lower) };
+  service->table[ CHANNEL_ENTRY_UPPER ] = (gatt_characteristic_t) {
+    .uuid = prefix | CHANNEL_UPPER_UUID, .attributes = BLE_ATTR_PROTECTED | BLE_ATTR_WRITE | BLE_ATTR_READ,
+    .length = size, .limit = size, .value = service->value.upper, .handles = &(service->handle.upper) };
+  service->table[ CHANNEL_ENTRY_EVENT ] = (gatt_characteristic_t) {
+    .uuid = prefix | CHANNEL_EVENT_UUID, .attributes = BLE_ATTR_PROTECTED | BLE_ATTR_VARIABLE | BLE_ATTR_NOTIFY | BLE_ATTR_WRITE | BLE_ATTR_READ, .link = CHANNEL_LINK_EVENT,
+    .limit = CHANNEL_RECORD_SIZE(layout->fields), .value = &(service->value.event), .handles = &(service->handle.event), .apply = (gatt_apply_t) channel_retrieve };
+  service->table[ CHANNEL_ENTRY_COUNT ] = (gatt_characteristic_t) {
+    .uuid = prefix | CHANNEL_COUNT_UUID, .attributes = BLE_ATTR_PROTECTED | BLE_ATTR_NOTIFY | BLE_ATTR_READ, .link = CHANNEL_LINK_COUNT,
+    .length = sizeof(short), .limit = sizeof(short), .value = &(service->value.count), .handles = &(service->handle.count) };
+
+  // Register the service with the soft device low energy stack and add the
+  // service characteristics.
+
+  result = gatt_register ( &(service->gatt), &(service->mutex), channel_uuid ( channel ), service->table, CHANNEL_ENTRIES, service, NULL );
+
+  // Request a subcription to the soft device event publisher.
+
+  if ( NRF_SUCCESS == result ) { result = softble_subscribe ( (softble_subscriber_t) channel_event, service ); }
+
+  // Return with registration result.
+
+  return ( result );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: channel_settings ( channel, lower, upper )
+// arguments: channel - measured channel
+//            lower - array to receive lower limit settings
+//            upper - array to receive upper limit settings
+//   returns: NRF_SUCCESS if retrieved
+//            NRF_ERROR_INVALID_STATE - if service is not registered
+//
+// Get the limit settings. The arrays are left untouched if the service has
+// not been registered.
+//-----------------------------------------------------------------------------
+
+unsigned channel_settings ( channel_type_t channel, float * lower, float * upper ) {
+
+  if ( channel >= CHANNELS ) return ( NRF_ERROR_INVALID_PARAM );
+
+  channel_t *                 service = &(resource[ channel ]);
+  unsigned short                 size = descriptors[ channel ].fields * sizeof(float);
+
+  // Make sure that the service has been registered with the stack.
+
+  if ( service->gatt.service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(service->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  if ( lower ) { memcpy ( lower, service->value.lower, size ); }
+  if ( upper ) { memcpy ( upper, service->value.upper, size ); }
+
+  return ( ctl_mutex_unlock ( &(service->mutex) ), NRF_SUCCESS );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: channel_configure ( channel, lower, upper )
+// arguments: channel - measured channel
+//            lower - lower limit settings (NULL to leave unchanged)
+//            upper - upper limit settings (NULL to leave unchanged)
+//   returns: NRF_SUCCESS - if updated
+//            NRF_ERROR_INVALID_STATE - if service is not registered
+//
+// Replace the limit settings and update the limit characteristics.
+//-----------------------------------------------------------------------------
+
+unsigned channel_configure ( channel_type_t channel, const float * lower, const float * upper ) {
+
+  if ( channel >= CHANNELS ) return ( NRF_ERROR_INVALID_PARAM );
+
+  channel_t *                 service = &(resource[ channel ]);
+  unsigned short                 size = descriptors[ channel ].fields * sizeof(float);
+  unsigned                     result = NRF_SUCCESS;
+
+  // Make sure that the service has been registered with the stack.
+
+  if ( service->gatt.service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(service->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  if ( lower ) { memcpy ( service->value.lower, lower, size ); }
+  if ( upper ) { memcpy ( service->value.upper, upper, size ); }
+
+  if ( NRF_SUCCESS == result ) { result = softble_characteristic_update ( service->handle.lower.value_handle, service->value.lower, 0, size ); }
+  if ( NRF_SUCCESS == result ) { result = softble_characteristic_update ( service->handle.upper.value_handle, service->value.upper, 0, size ); }
+
+  // Return with the result.
+
+  return ( ctl_mutex_unlock ( &(service->mutex) ), result );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: channel_measured ( channel, values, interval )
+// arguments: channel - measured channel
+//            values - measured values
+//            interval - measurement interval in seconds
+//   returns: NRF_SUCCESS - if update issued
+//            NRF_ERROR_INVALID_STATE - if service is not registered
+//
+// Update the measured values characteristic and accumulate the time spent
+// within and outside of compliance for each value with a valid limit range.
+//-----------------------------------------------------------------------------
+
+unsigned channel_measured ( channel_type_t channel, const float * values, float interval ) {
+
+  if ( channel >= CHANNELS ) return ( NRF_ERROR_INVALID_PARAM );
+  if ( ! values ) return ( NRF_ERROR_NULL );
+
+  channel_t *                 service = &(resource[ channel ]);
+  unsigned char                fields = descriptors[ channel ].fields;
+
+  // Make sure that the service has been registered with the stack.
+
+  if ( service->gatt.service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(service->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  // Update the resident values, which peers read directly, and notify them
+  // only if a peer has subscribed.
+
+  memcpy ( service->value.value, values, fields * sizeof(float) );
+
+  unsigned                     result = gatt_mark ( &(service->gatt), CHANNEL_LINK_VALUE );
+
+  // Check each value against the compliance requirements and adjust the
+  // incursion and excursion times accordingly.
+
+  for ( unsigned n = 0; n < fields; ++ n ) if ( service->value.lower[ n ] < service->value.upper[ n ] ) {
+
+    if ( (values[ n ] >= service->value.lower[ n ]) && (values[ n ] <= service->value.upper[ n ]) ) { service->compliance.incursion[ n ] += interval; }
+    else { service->compliance.excursion[ n ] += interval; }
+
+    }
+
+  // Return with the result.
+
+  return ( ctl_mutex_unlock ( &(service->mutex) ), result );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: channel_compliance ( channel, incursion, excursion )
+// arguments: channel - measured channel
+//            incursion - array to receive the time in compliance
+//            excursion - array to receive the time outside of compliance
+//   returns: NRF_SUCCESS - if retrieved
+//            NRF_ERROR_INVALID_STATE - if service is not registered
+//
+// Retrieve the accumulated compliance times of each channel value.
+//-----------------------------------------------------------------------------
+
+unsigned channel_compliance ( channel_type_t channel, float * incursion, float * excursion ) {
+
+  if ( channel >= CHANNELS ) return ( NRF_ERROR_INVALID_PARAM );
+
+  channel_t *                 service = &(resource[ channel ]);
+  unsigned short                 size = descriptors[ channel ].fields * sizeof(float);
+
+  // Make sure that the service has been registered with the stack.
+
+  if ( service->gatt.service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(service->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  // Retrieve the compliance times.
+
+  if ( incursion ) { memcpy ( incursion, service->compliance.incursion, size ); }
+  if ( excursion ) { memcpy ( excursion, service->compliance.excursion, size ); }
+
+  // Return with result.
+
+  return ( ctl_mutex_unlock ( &(service->mutex) ), NRF_SUCCESS );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: channel_archive ( channel )
+// arguments: channel - measured channel
+//   returns: NRF_SUCCESS - if update issued
+//            NRF_ERROR_INVALID_STATE - if service is not registered
+//
+// Request that the current values be quantized and recorded as an event in
+// the channel archive.
+//-----------------------------------------------------------------------------
+
+unsigned channel_archive ( channel_type_t channel ) {
+
+  if ( channel >= CHANNELS ) return ( NRF_ERROR_INVALID_PARAM );
+
+  channel_t *                 service = &(resource[ channel ]);
+  const channel_descriptor_t * layout = &(descriptors[ channel ]);
+  unsigned                     result = NRF_SUCCESS;
+
+  // Make sure that the service has been registered with the stack.
+
+  if ( service->gatt.service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(service->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  // Open the archive and append an event record based on the values in
+  // measurement characteristic.
+
+  file_handle_t               archive = file_open ( layout->archive, FILE_MODE_CREATE | FILE_MODE_WRITE | FILE_MODE_READ );
+
+  if ( archive > FILE_OK ) {
+
+    channel_record_t           record = { .time = ctl_time_get ( ) };
+    unsigned                     size = CHANNEL_RECORD_SIZE(layout->fields);
+    unsigned short             handle = service->handle.count.value_handle;
+    unsigned short              count = (unsigned short) (file_tail ( archive ) / size);
+
+    for ( unsigned n = 0; n < layout->fields; ++ n ) { record.data[ n ] = (short) roundf ( service->value.value[ n ] * layout->scale[ n ] ); }
+
+    if ( size == file_write ( archive, &(record), size ) ) { ++ count; }
+    else { result = NRF_ERROR_NO_MEM; }
+
+    service->value.count              = count;
+
+    if ( NRF_SUCCESS == result ) { result = channel_post ( service, CHANNEL_LINK_COUNT, handle, &(service->value.count), sizeof(short) ); }
+
+    file_close ( archive );
+
+    } else { result = NRF_ERROR_INTERNAL; }
+
+  // Return with the result.
+
+  return ( ctl_mutex_unlock ( &(service->mutex) ), result );
+
+  }
+
+
+//=============================================================================
+// SECTION : SERVICE RESPONDER
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+//  callback: channel_event ( channel, event )
+// arguments: channel - service resource
+//            event - BLE event structure
+//   returns: NRF_SUCCESS if event processed
+//
+// Bluetooth service responder callback handler.
+//-----------------------------------------------------------------------------
+
+static unsigned channel_event ( channel_t * channel, ble_evt_t * event ) {
+
+  switch ( event->header.evt_id ) {
+
+    case BLE_GAP_EVT_CONNECTED:   return channel_start ( channel, event->evt.gap_evt.conn_handle, &(event->evt.gap_evt.params.connected) );
+    case BLE_GAP_EVT_DISCONNECTED:return channel_close ( channel, event->evt.gap_evt.conn_handle, &(event->evt.gap_evt.params.disconnected) );
+    default:                      return gatt_event ( &(channel->gatt), event );
+
+    }
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: channel_start ( channel, connection, connected )
+// arguments: channel - service resource
+//            connection - connection handle
+//            connected - connected information structure
+//   returns: NRF_SUCCESS if processed
+//
+// Connection to a peer has been established. Attach the link, re-load the
+// event count and reset the event record characteristic. The measured values
+// are resident, so they never need to be posted.
+//-----------------------------------------------------------------------------
+
+static unsigned channel_start ( channel_t * channel, unsigned short connection, ble_gap_evt_connected_t * connected ) {
+
+  const channel_descriptor_t * layout = channel->descriptor;
+  file_handle_t               archive = file_open ( layout->archive, FILE_MODE_READ );
+  channel_record_t             record = { 0 };
+  unsigned short                count = 0;
+
+  if ( archive > FILE_OK ) { count = file_size ( archive, NULL ) / CHANNEL_RECORD_SIZE(layout->fields); }
+
+  ctl_mutex_lock_uc ( &(channel->mutex) );
+
+  gatt_attach ( &(channel->gatt), connection );
+  channel->value.count                = count;
+
+  softble_characteristic_update ( channel->handle.count.value_handle, &(channel->value.count), 0, sizeof(short) );
+  softble_characteristic_update ( channel->handle.event.value_handle, &(record), 0, 0 );
+
+  ctl_mutex_unlock ( &(channel->mutex) );
+
+  file_close ( archive );
+
+  return ( NRF_SUCCESS );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: channel_close ( channel, connection, disconnected )
+// arguments: channel - service resource
+//            connection - connection handle
+//            disconnected - disconnected information structure
+//   returns: NRF_SUCCESS if processed
+//
+// Connection to a peer has been lost. Release its link and subscriptions;
+// once no peers remain, value updates stay local until the next connection.
+//-----------------------------------------------------------------------------
+
+static unsigned channel_close ( channel_t * channel, unsigned short connection, ble_gap_evt_disconnected_t * disconnected ) {
+
+  ctl_mutex_lock_uc ( &(channel->mutex) );
+
+  gatt_detach ( &(channel->gatt), connection );
+
+  return ( ctl_mutex_unlock ( &(channel->mutex) ), NRF_SUCCESS );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: channel_retrieve ( channel, connection, write )
+// arguments: channel - service resource
+//            connection - connection handle
+//            write - write information structure
+//
+// Event characteristic write hook. A record index written to the event
+// characteristic requests that record from the archive.
+//-----------------------------------------------------------------------------
+
+static void channel_retrieve ( channel_t * channel, unsigned short connection, ble_gatts_evt_write_t * write ) {
+
+  if ( write->len == sizeof(short) ) { channel_fetch ( channel, connection, *((unsigned short *) write->data) ); }
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: channel_fetch ( channel, connection, index )
+// arguments: channel - service resource
+//            connection - connection handle of the requesting peer
+//            index - event record index
+//   returns: NRF_SUCCESS if successful
+//
+// Retrieve the event record from the archive and post it to the event
+// characteristic with notification.
+//-----------------------------------------------------------------------------
+
+static unsigned channel_fetch ( channel_t * channel, unsigned short connection, unsigned short index ) {
+
+  const channel_descriptor_t * layout = channel->descriptor;
+  file_handle_t               archive = file_open ( layout->archive, FILE_MODE_READ );
+  unsigned short               handle = channel->handle.event.value_handle;
+  unsigned                     result = NRF_ERROR_NULL;
+
+  if ( archive > FILE_OK ) {
+
+    channel_record_t           record = { 0 };
+    unsigned                     size = CHANNEL_RECORD_SIZE(layout->fields);
+    int                        offset = size * index;
+
+    if ( (offset == file_seek ( archive, FILE_SEEK_POSITION, offset ))
+      && (size == file_read ( archive, &(record), size )) ) { result = NRF_SUCCESS; }
+
+    if ( NRF_SUCCESS == result ) { result = softble_characteristic_update ( handle, &(record), 0, size ); }
+    if ( NRF_SUCCESS == result ) { gatt_notify ( &(channel->gatt), CHANNEL_LINK_EVENT, connection ); }
+
+    file_close ( archive );
+
+    }
+
+  return ( result );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: channel_post ( channel, link, handle, value, size )
+// arguments: channel - service resource
+//            link - characteristic link bit
+//            handle - characteristic value handle
+//            value - characteristic value
+//            size - size of the value in bytes
+//   returns: NRF_SUCCESS if posted or skipped
+//
+// Post a characteristic value to the stack and notify the peer if it has
+// subscribed. Without a linked peer, the update is skipped; the stack values
+// are refreshed when the next peer connects.
+//-----------------------------------------------------------------------------
+
+static unsigned channel_post ( channel_t * channel, unsigned char link, unsigned short handle, void * value, unsigned short size ) {
+
+  unsigned                     result = NRF_SUCCESS;
+
+  // Without a peer there is nobody to read or be notified of the value.
+
+  if ( channel->gatt.links == 0 ) return ( result );
+
+  // Update the stack value and notify the subscribed peers.
+
+  if ( NRF_SUCCESS == (result = softble_characteristic_update ( handle, value, 0, size )) ) {
+    gatt_notify ( &(channel->gatt), link, BLE_CONN_HANDLE_ALL );
+    }
+
+  return ( result );
+
+  }
+
+
+//=============================================================================
+// SECTION : CHANNEL SERVICES
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+// The surface temperature service is a single value channel.
+//-----------------------------------------------------------------------------
+
+unsigned surface_register ( float lower, float upper ) { return ( channel_register ( CHANNEL_SURFACE, &(lower), &(upper) ) ); }
+unsigned surface_settings ( float * lower, float * upper ) { return ( channel_settings ( CHANNEL_SURFACE, lower, upper ) ); }
+unsigned surface_configure ( float lower, float upper ) { return ( channel_configure ( CHANNEL_SURFACE, &(lower), &(upper) ) ); }
+unsigned surface_measured ( float value, float interval ) { return ( channel_measured ( CHANNEL_SURFACE, &(value), interval ) ); }
+unsigned surface_compliance ( surface_compliance_t * incursion, surface_compliance_t * excursion ) { return ( channel_compliance ( CHANNEL_SURFACE, incursion, excursion ) ); }
+unsigned surface_archive ( void ) { return ( channel_archive ( CHANNEL_SURFACE ) ); }
+
+//-----------------------------------------------------------------------------
+// The atmospheric telemetry service is a three value channel, measuring the
+// temperature, humidity and pressure in that order.
+//-----------------------------------------------------------------------------
+
+unsigned atmosphere_register ( atmosphere_values_t * lower, atmosphere_values_t * upper ) { return ( channel_register ( CHANNEL_ATMOSPHERE, (float *) lower, (float *) upper ) ); }
+unsigned atmosphere_settings ( atmosphere_values_t * lower, atmosphere_values_t * upper ) { return ( channel_settings ( CHANNEL_ATMOSPHERE, (float *) lower, (float *) upper ) ); }
+unsigned atmosphere_configure ( atmosphere_values_t * lower, atmosphere_values_t * upper ) { return ( channel_configure ( CHANNEL_ATMOSPHERE, (float *) lower, (float *) upper ) ); }
+unsigned atmosphere_measured ( atmosphere_values_t * values, float interval ) { return ( channel_measured ( CHANNEL_ATMOSPHERE, (float *) values, interval ) ); }
+unsigned atmosphere_compliance ( atmosphere_compliance_t * incursion, atmosphere_compliance_t * excursion ) { return ( channel_compliance ( CHANNEL_ATMOSPHERE, (float *) incursion, (float *) excursion ) ); }
+unsigned atmosphere_archive ( void ) { return ( channel_archive ( CHANNEL_ATMOSPHERE ) ); }
@@ -0,0 +1,146 @@
+//=============================================================================
+// project: ShockVx
+//  module: Stickershock firmware for cold chain tracking.
+//  author: Velvetwire, llc
+//    file: channel.h
+//
+// Measured channel telemetry and settings service engine.
+//
+// (c) Copyright 2016-2020 Velvetwire, LLC. All rights reserved.
+//=============================================================================
+
+#ifndef   __CHANNEL__
+#define   __CHANNEL__
+
+//-----------------------------------------------------------------------------
+// Each measured channel is described by its service UUID component, the
+// number of values it measures, the scale used to quantize each value into
+// its archive record and the path of the archive file.
+//-----------------------------------------------------------------------------
+
+typedef   struct {                                                              // Channel descriptor:
+
+          unsigned                    identity;                                 //  32-bit service UUID component
+          unsigned char               fields;                                   //  Number of measured values
+          float                       scale [ CHANNEL_FIELD_LIMIT ];            //  Archive quantization scale per value
+          const char *                archive;                                  //  Archive file
+
+          } channel_descriptor_t;
+
+//-----------------------------------------------------------------------------
+// Channel event archives
+//-----------------------------------------------------------------------------
+
+#define   CHANNEL_SURFACE_ARCHIVE     "internal:archive/surface.rec"            // Surface temperature archive file
+#define   CHANNEL_ATMOSPHERE_ARCHIVE  "internal:archive/atmosphere.rec"         // Atmospheric archive file
+
+typedef   struct __attribute__ (( packed )) {                                   // Channel archive record:
+
+          unsigned                    time;                                     //  UTC time stamp
+          signed short                data [ CHANNEL_FIELD_LIMIT ];             //  Quantized values (only the channel fields are stored)
+
+          } channel_record_t;
+
+#define   CHANNEL_RECORD_SIZE(f)      (sizeof(unsigned) + (f) * sizeof(signed short))
+
+//-----------------------------------------------------------------------------
+// Channel GATT services
+//-----------------------------------------------------------------------------
+
+#define   CHANNEL_SURFACE_UUID        (0x53740000)                              // 32-bit service UUID component (St00)
+#define   CHANNEL_ATMOSPHERE_UUID     (0x41740000)                              // 32-bit service UUID component (At00)
+
+//-----------------------------------------------------------------------------
+// Characteristic table entries, in registration order.
+//-----------------------------------------------------------------------------
+
+#define   CHANNEL_ENTRY_VALUE         (0)                                       // Measured values
+#define   CHANNEL_ENTRY_LOWER         (1)                                       // Lower limits
+#define   CHANNEL_ENTRY_UPPER         (2)                                       // Upper limits
+#define   CHANNEL_ENTRY_EVENT         (3)                                       // Archived event record
+#define   CHANNEL_ENTRY_COUNT         (4)                                       // Record count
+#define   CHANNEL_ENTRIES             (5)
+
+//-----------------------------------------------------------------------------
+// Service resource
+//-----------------------------------------------------------------------------
+
+typedef   struct {
+
+          CTL_MUTEX_t                 mutex;                                    // Access mutex
+          gatt_service_t              gatt;                                     // Service table
+          gatt_characteristic_t       table [ CHANNEL_ENTRIES ];                // Characteristic table
+          const channel_descriptor_t * descriptor;                              // Channel descriptor
+          uuid_t                      id;                                       // Service UUID
+
+          struct {                                                              // Characteristic handles:
+
+            ble_gatts_char_handles_t  value;                                    //  Value characteristic
+            ble_gatts_char_handles_t  lower;                                    //  Lower limit characteristic
+            ble_gatts_char_handles_t  upper;                                    //  Upper limit characteristic
+
+            ble_gatts_char_handles_t  event;                                    //  Archived event data (or index)
+            ble_gatts_char_handles_t  count;                                    //  Record count
+
+            } handle;
+
+          struct {                                                              // Characteristic values:
+
+            float                     value [ CHANNEL_FIELD_LIMIT ];            //  Measured values
+            float                     lower [ CHANNEL_FIELD_LIMIT ];            //  Lower limits
+            float                     upper [ CHANNEL_FIELD_LIMIT ];            //  Upper limits
+
+            channel_record_t          event;                                    //  Archived event data (or index)
+            unsigned short            count;                                    //  Record count
+
+            } value;
+
+          struct {                                                              // Compliance values:
+
+            float                     incursion [ CHANNEL_FIELD_LIMIT ];        //  Time within compliance
+            float                     excursion [ CHANNEL_FIELD_LIMIT ];        //  Time outside compliance
+
+            } compliance;
+
+          } channel_t;
+
+static    unsigned                    channel_event ( channel_t * channel, ble_evt_t * event );
+
+static    unsigned                    channel_start ( channel_t * channel, unsigned short connection, ble_gap_evt_connected_t * connected );
+static    unsigned                    channel_close ( channel_t * channel, unsigned short connection, ble_gap_evt_disconnected_t * disconnected );
+static    unsigned                    channel_fetch ( channel_t * channel, unsigned short connection, unsigned short index );
+
+//-----------------------------------------------------------------------------
+// The measured values are resident and only notified while a peer has
+// subscribed. Other characteristic values are only pushed to the stack while
+// a peer is linked; otherwise, they are refreshed on the next peer
+// connection.
+//-----------------------------------------------------------------------------
+
+#define   CHANNEL_LINK_VALUE          (1 << 0)                                  // Measured values (resident)
+#define   CHANNEL_LINK_EVENT          (1 << 1)                                  // Archived event record
+#define   CHANNEL_LINK_COUNT          (1 << 2)                                  // Record count
+
+static    unsigned                    channel_post ( channel_t * channel, unsigned char link, unsigned short handle, void * value, unsigned short size );
+
+//-----------------------------------------------------------------------------
+// Characteristic UUID components. These are combined with the upper half of
+// the channel service UUID component.
+//-----------------------------------------------------------------------------
+
+#define   CHANNEL_VALUE_UUID          (0x00004D76)                              // Measurement value characteristic (--Mv)
+#define   CHANNEL_LOWER_UUID          (0x00004C6C)                              // Lower limits characteristic (--Ll)
+#define   CHANNEL_UPPER_UUID          (0x0000556C)                              // Upper limits characteristic (--Ul)
+
+//-----------------------------------------------------------------------------
+// Archived event record characteristics. Writing a record index to the event
+// characteristic fetches that record from the archive.
+//-----------------------------------------------------------------------------
+
+#define   CHANNEL_COUNT_UUID          (0x00005263)                              // Record count characteristic (--Rc)
+#define   CHANNEL_EVENT_UUID          (0x00005265)                              // Archived event characteristic (--Re)
+
+static    void                        channel_retrieve ( channel_t * channel, unsigned short connection, ble_gatts_evt_write_t * write );
+
+//=============================================================================
+#endif
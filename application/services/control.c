@@ -10,6 +10,7 @@
 #include  <stickershock.h>
 
 #include  "bluetooth.h"
+#include  "gatt.h"
 #include  "control.h"
 
 //=============================================================================
@@ -22,6 +23,45 @@
 
 static    control_t           resource = { 0 };
 
+//-----------------------------------------------------------------------------
+// Declare the service characteristic table, in registration order. The lock,
+// opened and closed attributes are adjusted at registration.
+//-----------------------------------------------------------------------------
+
+static    gatt_characteristic_t       characteristics [ CONTROL_ENTRIES ] = {
+
+  [ CONTROL_ENTRY_NODE ]     = { .uuid = CONTROL_NODE_UUID, .attributes = BLE_ATTR_PROTECTED | BLE_ATTR_WRITE | BLE_ATTR_READ,
+                                 .length = sizeof(hash_t), .limit = sizeof(hash_t), .value = &(resource.value.node), .handles = &(resource.handle.node) },
+  [ CONTROL_ENTRY_LOCK ]     = { .uuid = CONTROL_LOCK_UUID, .attributes = BLE_ATTR_PROTECTED | BLE_ATTR_WRITE,
+                                 .length = SOFTDEVICE_KEY_LENGTH, .limit = SOFTDEVICE_KEY_LENGTH, .value = &(resource.value.lock), .handles = &(resource.handle.lock) },
+  [ CONTROL_ENTRY_OPENED ]   = { .uuid = CONTROL_OPENED_UUID, .attributes = BLE_ATTR_PROTECTED | BLE_ATTR_WRITE | BLE_ATTR_READ,
+                                 .length = SOFTDEVICE_KEY_LENGTH, .limit = SOFTDEVICE_KEY_LENGTH, .value = &(resource.value.opened), .handles = &(resource.handle.opened) },
+  [ CONTROL_ENTRY_CLOSED ]   = { .uuid = CONTROL_CLOSED_UUID, .attributes = BLE_ATTR_PROTECTED | BLE_ATTR_WRITE | BLE_ATTR_READ,
+                                 .length = SOFTDEVICE_KEY_LENGTH, .limit = SOFTDEVICE_KEY_LENGTH, .value = &(resource.value.closed), .handles = &(resource.handle.closed) },
+  [ CONTROL_ENTRY_WINDOW ]   = { .uuid = CONTROL_WINDOW_UUID, .attributes = BLE_ATTR_READ,
+                                 .length = sizeof(control_window_t), .limit = sizeof(control_window_t), .value = &(resource.value.window), .handles = &(resource.handle.window) },
+  [ CONTROL_ENTRY_SUMMARY ]  = { .uuid = CONTROL_SUMMARY_UUID, .attributes = BLE_ATTR_NOTIFY | BLE_ATTR_READ, .link = CONTROL_LINK_SUMMARY,
+                                 .length = sizeof(control_summary_t), .limit = sizeof(control_summary_t), .value = &(resource.value.summary), .handles = &(resource.handle.summary) },
+  [ CONTROL_ENTRY_SETTINGS ] = { .uuid = CONTROL_SETTINGS_UUID, .attributes = BLE_ATTR_PROTECTED | BLE_ATTR_AUTHORIZE | BLE_ATTR_WRITE | BLE_ATTR_READ,
+                                 .length = sizeof(control_settings_t), .limit = sizeof(control_settings_t), .value = &(resource.value.settings), .handles = &(resource.handle.settings) },
+  [ CONTROL_ENTRY_DATABASE ] = { .uuid = CONTROL_DATABASE_UUID, .attributes = BLE_ATTR_READ,
+                                 .length = sizeof(hash_t), .limit = sizeof(hash_t), .value = &(resource.value.database), .handles = &(resource.handle.database) },
+  [ CONTROL_ENTRY_COMMAND ]  = { .uuid = CONTROL_COMMAND_UUID, .attributes = BLE_ATTR_WRITE,
+                                 .length = sizeof(unsigned char), .limit = sizeof(unsigned char), .value = &(resource.value.command), .handles = &(resource.handle.command),
+                                 .apply = (gatt_apply_t) control_command },
+  [ CONTROL_ENTRY_MEASUREMENT ] = { .uuid = CONTROL_MEASUREMENT_UUID, .attributes = BLE_ATTR_NOTIFY | BLE_ATTR_READ, .link = CONTROL_LINK_MEASUREMENT,
+                                 .length = sizeof(control_measurement_t), .limit = sizeof(control_measurement_t), .value = &(resource.value.measurement), .handles = &(resource.handle.measurement) },
+  [ CONTROL_ENTRY_LOCATION ] = { .uuid = CONTROL_LOCATION_UUID, .attributes = BLE_ATTR_PROTECTED | BLE_ATTR_WRITE | BLE_ATTR_READ,
+                                 .length = sizeof(control_location_t), .limit = sizeof(control_location_t), .value = &(resource.value.location), .handles = &(resource.handle.location),
+                                 .apply = (gatt_apply_t) control_locate },
+  [ CONTROL_ENTRY_RECORD ]   = { .uuid = CONTROL_RECORD_UUID, .attributes = BLE_ATTR_PROTECTED | BLE_ATTR_VARIABLE | BLE_ATTR_NOTIFY | BLE_ATTR_WRITE | BLE_ATTR_READ, .link = CONTROL_LINK_RECORD,
+                                 .limit = sizeof(control_record_t), .value = &(resource.value.record), .handles = &(resource.handle.record),
+                                 .apply = (gatt_apply_t) control_retrieve },
+  [ CONTROL_ENTRY_COUNT ]    = { .uuid = CONTROL_COUNT_UUID, .attributes = BLE_ATTR_PROTECTED | BLE_ATTR_NOTIFY | BLE_ATTR_READ, .link = CONTROL_LINK_COUNT,
+                                 .length = sizeof(short), .limit = sizeof(short), .value = &(resource.value.count), .handles = &(resource.handle.count) },
+
+  };
+
 //-----------------------------------------------------------------------------
 //  function: control_uuid ( )
 // arguments: none
@@ -58,24 +98,25 @@ unsigned control_register ( void * node, void * lock, void * opened, void * clos
 
   // Initialize the service resource.
 
-  if ( control->service == BLE_GATT_HANDLE_INVALID ) { ctl_mutex_init ( &(control->mutex) ); }
+  if ( control->gatt.service == BLE_GATT_HANDLE_INVALID ) { ctl_mutex_init ( &(control->mutex) ); }
   else return ( NRF_ERROR_INVALID_STATE );
 
-  // Register the service with the soft device low energy stack and add the
-  // service characteristics.
-
-  if ( (control->service = softble_server_register ( BLE_GATTS_SRVC_TYPE_PRIMARY, control_uuid ( ) )) ) {
+  if ( node ) { memcpy ( &(control->value.node), node, sizeof(hash_t) ); }
+  if ( lock ) { memcpy ( control->value.lock, lock, SOFTDEVICE_KEY_LENGTH ); }
+  if ( opened ) { memcpy ( control->value.opened, opened, SOFTDEVICE_KEY_LENGTH ); }
+  if ( closed ) { memcpy ( control->value.closed, closed, SOFTDEVICE_KEY_LENGTH ); }
 
-    if ( NRF_SUCCESS == result ) { result = control_node_characteristic ( control, node ); }
-    if ( NRF_SUCCESS == result ) { result = control_lock_characteristic ( control, lock ); }
+  // An established lock is left out of the service, and the opened and closed
+  // signatures can only be written while they are blank.
 
-    if ( NRF_SUCCESS == result ) { result = control_opened_characteristic ( control, opened ); }
-    if ( NRF_SUCCESS == result ) { result = control_closed_characteristic ( control, closed ); }
-    if ( NRF_SUCCESS == result ) { result = control_window_characteristic ( control ); }
+  if ( ! control_blank ( control->value.lock ) ) { characteristics[ CONTROL_ENTRY_LOCK ].attributes = 0; }
+  if ( ! control_blank ( control->value.opened ) ) { characteristics[ CONTROL_ENTRY_OPENED ].attributes &= ~(BLE_ATTR_WRITE); }
+  if ( ! control_blank ( control->value.closed ) ) { characteristics[ CONTROL_ENTRY_CLOSED ].attributes &= ~(BLE_ATTR_WRITE); }
 
-    if ( NRF_SUCCESS == result ) { result = control_summary_characteristic ( control ); }
+  // Register the service with the soft device low energy stack and add the
+  // service characteristics.
 
-    } else return ( NRF_ERROR_RESOURCES );
+  result = gatt_register ( &(control->gatt), &(control->mutex), control_uuid ( ), characteristics, CONTROL_ENTRIES, control, NULL );
 
   // Request a subcription to the soft device event publisher.
 
@@ -104,7 +145,7 @@ unsigned control_window ( unsigned opened, unsigned closed ) {
 
   // Make sure that the requested notice is valid and register the notice.
 
-  if ( control->service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(control->mutex) ); }
+  if ( control->gatt.service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(control->mutex) ); }
   else return ( NRF_ERROR_INVALID_STATE );
 
   // Update the window characteristic.
@@ -167,15 +208,83 @@ unsigned control_status ( control_status_t status, float memory, float storage )
 
   // Make sure that the requested notice is valid and register the notice.
 
-  if ( control->service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(control->mutex) ); }
+  if ( control->gatt.service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(control->mutex) ); }
   else return ( NRF_ERROR_INVALID_STATE );
 
-  // Update the metrics values structure and issue a notify to any connected peers.
+  // Update the metrics values structure and issue a notify to any subscribed peers.
 
   unsigned short               handle = control->handle.summary.value_handle;
   unsigned                     result = softble_characteristic_update ( handle, &(summary), 0, sizeof(control_summary_t) );
 
-  if ( NRF_SUCCESS == result ) { softble_characteristic_notify ( handle, BLE_CONN_HANDLE_ALL ); }
+  if ( NRF_SUCCESS == result ) { gatt_notify ( &(control->gatt), CONTROL_LINK_SUMMARY, BLE_CONN_HANDLE_ALL ); }
+
+  // Return with the result.
+
+  return ( ctl_mutex_unlock ( &(control->mutex) ), result );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: control_database ( )
+// arguments: none
+//   returns: NRF_SUCCESS - if update issued
+//            NRF_ERROR_INVALID_STATE - if service is not registered
+//
+// Publish the signature of the attribute database. This is called once all
+// of the services have been registered.
+//-----------------------------------------------------------------------------
+
+unsigned control_database ( void ) {
+
+  control_t *                 control = &(resource);
+
+  // Make sure that the service has been registered with the stack.
+
+  if ( control->gatt.service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(control->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  // Take the signature of the layout and update the characteristic.
+
+  control->value.database             = gatt_signature ( );
+
+  unsigned short               handle = control->handle.database.value_handle;
+  unsigned                     result = softble_characteristic_update ( handle, &(control->value.database), 0, sizeof(hash_t) );
+
+  // Return with the result.
+
+  return ( ctl_mutex_unlock ( &(control->mutex) ), result );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: control_measurement ( measurement )
+// arguments: measurement - combined measurement
+//   returns: NRF_SUCCESS - if update issued
+//            NRF_ERROR_INVALID_STATE - if service is not registered
+//
+// Publish the result of an on-demand measurement and notify any subscribed
+// peers.
+//-----------------------------------------------------------------------------
+
+unsigned control_measurement ( control_measurement_t * measurement ) {
+
+  control_t *                 control = &(resource);
+
+  if ( ! measurement ) return ( NRF_ERROR_NULL );
+
+  // Make sure that the service has been registered with the stack.
+
+  if ( control->gatt.service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(control->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  // Update the measurement characteristic and issue a notify to any subscribed peers.
+
+  memcpy ( &(control->value.measurement), measurement, sizeof(control_measurement_t) );
+
+  unsigned short               handle = control->handle.measurement.value_handle;
+  unsigned                     result = softble_characteristic_update ( handle, &(control->value.measurement), 0, sizeof(control_measurement_t) );
+
+  if ( NRF_SUCCESS == result ) { gatt_notify ( &(control->gatt), CONTROL_LINK_MEASUREMENT, BLE_CONN_HANDLE_ALL ); }
 
   // Return with the result.
 
@@ -183,6 +292,175 @@ unsigned control_status ( control_status_t status, float memory, float storage )
 
   }
 
+//-----------------------------------------------------------------------------
+//  function: control_location ( location )
+// arguments: location - location context
+//   returns: NRF_SUCCESS - if retrieved
+//            NRF_ERROR_NULL - if no location buffer was provided
+//
+// Retrieve the last location written by a gateway or reader.
+//-----------------------------------------------------------------------------
+
+unsigned control_location ( control_location_t * location ) {
+
+  control_t *                 control = &(resource);
+
+  if ( location ) { ctl_mutex_lock_uc ( &(control->mutex) ); }
+  else return ( NRF_ERROR_NULL );
+
+  memcpy ( location, &(control->value.location), sizeof(control_location_t) );
+
+  return ( ctl_mutex_unlock ( &(control->mutex) ), NRF_SUCCESS );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: control_archive ( location )
+// arguments: location - location context
+//   returns: NRF_SUCCESS - if the record was archived
+//            NRF_ERROR_NULL - if no location was provided
+//            NRF_ERROR_NO_MEM - if the record could not be written
+//            NRF_ERROR_INTERNAL - if the archive could not be opened
+//
+// Append a time stamped location record to the location archive and post the
+// new record count to any subscribed peers.
+//-----------------------------------------------------------------------------
+
+unsigned control_archive ( control_location_t * location ) {
+
+  control_t *                 control = &(resource);
+  unsigned                     result = NRF_SUCCESS;
+
+  if ( location ) { ctl_mutex_lock_uc ( &(control->mutex) ); }
+  else return ( NRF_ERROR_NULL );
+
+  // Open the archive and append the location record.
+
+  file_handle_t               archive = file_open ( CONTROL_LOCATION_ARCHIVE, FILE_MODE_CREATE | FILE_MODE_WRITE | FILE_MODE_READ );
+
+  if ( archive > FILE_OK ) {
+
+    control_record_t           record = { .time = ctl_time_get ( ) };
+    unsigned short             handle = control->handle.count.value_handle;
+    unsigned short              count = (unsigned short) (file_tail ( archive ) / sizeof(control_record_t));
+
+    memcpy ( &(record.location), location, sizeof(control_location_t) );
+
+    if ( sizeof(control_record_t) == file_write ( archive, &(record), sizeof(control_record_t) ) ) { ++ count; }
+    else { result = NRF_ERROR_NO_MEM; }
+
+    control->value.count              = count;
+
+    if ( (NRF_SUCCESS == result) && (control->gatt.service != BLE_GATT_HANDLE_INVALID) ) {
+
+      if ( NRF_SUCCESS == softble_characteristic_update ( handle, &(control->value.count), 0, sizeof(short) ) ) { gatt_notify ( &(control->gatt), CONTROL_LINK_COUNT, BLE_CONN_HANDLE_ALL ); }
+
+      }
+
+    file_close ( archive );
+
+    } else { result = NRF_ERROR_INTERNAL; }
+
+  // Return with the result.
+
+  return ( ctl_mutex_unlock ( &(control->mutex) ), result );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: control_publish ( settings )
+// arguments: settings - current provisioning settings
+//   returns: NRF_SUCCESS - if update issued
+//            NRF_ERROR_INVALID_STATE - if service is not registered
+//
+// Publish the current provisioning settings through the bulk settings
+// characteristic. The version and checksum are filled in and the lock is
+// withheld.
+//-----------------------------------------------------------------------------
+
+unsigned control_publish ( control_settings_t * settings ) {
+
+  control_t *                 control = &(resource);
+
+  if ( ! settings ) return ( NRF_ERROR_NULL );
+
+  // Make sure that the service has been registered with the stack.
+
+  if ( control->gatt.service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(control->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  // Prepare the blob and update the characteristic.
+
+  memcpy ( &(control->value.settings), settings, sizeof(control_settings_t) );
+  memset ( control->value.settings.lock, 0, SOFTDEVICE_KEY_LENGTH );
+
+  control->value.settings.version     = CONTROL_SETTINGS_VERSION;
+  control->value.settings.checksum    = control_checksum ( &(control->value.settings), offsetof(control_settings_t, checksum) );
+
+  unsigned short               handle = control->handle.settings.value_handle;
+  unsigned                     result = softble_characteristic_update ( handle, &(control->value.settings), 0, sizeof(control_settings_t) );
+
+  // Return with the result.
+
+  return ( ctl_mutex_unlock ( &(control->mutex) ), result );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: control_provision ( settings )
+// arguments: settings - structure to receive the provisioning settings
+//   returns: NRF_SUCCESS - if retrieved
+//            NRF_ERROR_INVALID_STATE - if service is not registered
+//
+// Retrieve the provisioning settings most recently accepted from the peer.
+//-----------------------------------------------------------------------------
+
+unsigned control_provision ( control_settings_t * settings ) {
+
+  control_t *                 control = &(resource);
+
+  if ( ! settings ) return ( NRF_ERROR_NULL );
+
+  // Make sure that the service has been registered with the stack.
+
+  if ( control->gatt.service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(control->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  memcpy ( settings, &(control->value.settings), sizeof(control_settings_t) );
+
+  return ( ctl_mutex_unlock ( &(control->mutex) ), NRF_SUCCESS );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: control_notice ( notice, set, events )
+// arguments: notice - the notice index to enable or disable
+//            set - event set to trigger (NULL to disable)
+//            events - event bits to set
+//   returns: NRF_SUCCESS - if notice enabled
+//            NRF_ERROR_INVALID_PARAM - if the notice index is not valid
+//
+// Register for notices with the control service.
+//-----------------------------------------------------------------------------
+
+unsigned control_notice ( control_notice_t notice, CTL_EVENT_SET_t * set, CTL_EVENT_SET_t events ) {
+
+  control_t *                 control = &(resource);
+
+  // Make sure that the requested notice is valid and register the notice.
+
+  if ( notice < CONTROL_NOTICES ) { ctl_mutex_lock_uc ( &(control->mutex) ); }
+  else return ( NRF_ERROR_INVALID_PARAM );
+
+  control->notice[ notice ].set       = set;
+  control->notice[ notice ].events    = events;
+
+  // Notice registered.
+
+  return ( ctl_mutex_unlock ( &(control->mutex) ), NRF_SUCCESS );
+
+  }
+
 
 //=============================================================================
 // SECTION : SERVICE RESPONDER
@@ -201,190 +479,312 @@ static unsigned control_event ( control_t * control, ble_evt_t * event ) {
 
   switch ( event->header.evt_id ) {
 
-    case BLE_GATTS_EVT_WRITE:     return control_write ( control, event->evt.gatts_evt.conn_handle, &(event->evt.gatts_evt.params.write) );
+    case BLE_GAP_EVT_CONNECTED:   return control_start ( control, event->evt.gap_evt.conn_handle, &(event->evt.gap_evt.params.connected) );
+    case BLE_GAP_EVT_DISCONNECTED:return control_close ( control, event->evt.gap_evt.conn_handle, &(event->evt.gap_evt.params.disconnected) );
+
+    case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+                                  return control_authorize ( control, event->evt.gatts_evt.conn_handle, &(event->evt.gatts_evt.params.authorize_request) );
 
-    default:                      return ( NRF_SUCCESS );
+    default:                      return gatt_event ( &(control->gatt), event );
 
     }
 
   }
 
 //-----------------------------------------------------------------------------
-//  function: control_write ( control, connection, write )
+//  function: control_start ( control, connection, connected )
 // arguments: control - service resource
 //            connection - connection handle
-//            write - write information structure
+//            connected - connected information structure
 //   returns: NRF_SUCCESS if processed
 //
-// Handle service characteristic write reqests.
+// Connection to a peer has been established. Attach the link, re-load the
+// location record count and reset the archived location characteristic.
 //-----------------------------------------------------------------------------
 
-static unsigned control_write ( control_t * control, unsigned short connection, ble_gatts_evt_write_t * write ) {
+static unsigned control_start ( control_t * control, unsigned short connection, ble_gap_evt_connected_t * connected ) {
 
-  // For protected characteristics, the write data needs to be transferred
-  // directly to the value data.
+  file_handle_t               archive = file_open ( CONTROL_LOCATION_ARCHIVE, FILE_MODE_READ );
+  control_record_t             record = { 0 };
+  unsigned short                count = 0;
 
-  if ( write->handle == control->handle.node.value_handle ) { memcpy ( (void *) &(control->value.node) + write->offset, write->data, write->len ); }
-  if ( write->handle == control->handle.lock.value_handle ) { memcpy ( control->value.lock + write->offset, write->data, write->len ); }
+  if ( archive > FILE_OK ) { count = file_size ( archive, NULL ) / sizeof(control_record_t); }
 
-  if ( write->handle == control->handle.opened.value_handle ) { memcpy ( control->value.opened + write->offset, write->data, write->len ); }
-  if ( write->handle == control->handle.closed.value_handle ) { memcpy ( control->value.closed + write->offset, write->data, write->len ); }
+  ctl_mutex_lock_uc ( &(control->mutex) );
 
-  // Write processed.
+  gatt_attach ( &(control->gatt), connection );
+  control->value.count                = count;
 
-  return ( NRF_SUCCESS );
+  softble_characteristic_update ( control->handle.count.value_handle, &(control->value.count), 0, sizeof(short) );
+  softble_characteristic_update ( control->handle.record.value_handle, &(record), 0, 0 );
 
-  }
+  ctl_mutex_unlock ( &(control->mutex) );
 
+  file_close ( archive );
 
-//=============================================================================
-// SECTION : SERVICE CHARACTERISTIC DECLARATIONS
-//=============================================================================
+  return ( NRF_SUCCESS );
+
+  }
 
 //-----------------------------------------------------------------------------
-//  function: control_node_characteristic ( control, node )
+//  function: control_close ( control, connection, disconnected )
 // arguments: control - service resource
-//            node - initialization value
-//   returns: NRF_ERROR_INVALID_PARAM - if parameters are invalid or missing
-//            NRF_SUCCESS - if added
+//            connection - connection handle
+//            disconnected - disconnected information structure
+//   returns: NRF_SUCCESS if processed
 //
-// Register the node identity characteristic with the GATT service.
+// Connection to a peer has been lost. Release its link.
 //-----------------------------------------------------------------------------
 
-static unsigned control_node_characteristic ( control_t * control, void * node ) {
+static unsigned control_close ( control_t * control, unsigned short connection, ble_gap_evt_disconnected_t * disconnected ) {
 
-  const void *                   uuid = control_id ( CONTROL_NODE_UUID );
-  softble_characteristic_t       data = { .handles  = &(control->handle.node),
-                                          .length   = sizeof(hash_t),
-                                          .limit    = sizeof(hash_t),
-                                          .value    = &(control->value.node) };
+  ctl_mutex_lock_uc ( &(control->mutex) );
 
-  if ( node ) { memcpy ( &(control->value.node), node, sizeof(hash_t) ); }
+  gatt_detach ( &(control->gatt), connection );
 
-  return ( softble_characteristic_declare ( control->service, BLE_ATTR_PROTECTED | BLE_ATTR_WRITE | BLE_ATTR_READ, uuid, &(data) ) );
+  return ( ctl_mutex_unlock ( &(control->mutex) ), NRF_SUCCESS );
 
   }
 
 //-----------------------------------------------------------------------------
-//  function: control_lock_characteristic ( control, lock )
+//  function: control_command ( control, connection, write )
 // arguments: control - service resource
-//            lock - initialization value
-//   returns: NRF_ERROR_INVALID_PARAM - if parameters are invalid or missing
-//            NRF_ERROR_FORBIDDEN - if the lock is already established
-//            NRF_SUCCESS - if added
+//            connection - connection handle
+//            write - write information structure
+//   returns: nothing
 //
-// Register the node lock characteristic with the GATT service. It is only
-// included if the lock is empty.
+// Act on a command written by the peer. Unknown commands are ignored.
 //-----------------------------------------------------------------------------
 
-static unsigned control_lock_characteristic ( control_t * control, void * lock ) {
+static void control_command ( control_t * control, unsigned short connection, ble_gatts_evt_write_t * write ) {
 
-  const void *                   uuid = control_id ( CONTROL_LOCK_UUID );
-  softble_characteristic_t       data = { .handles  = &(control->handle.lock),
-                                          .length   = SOFTDEVICE_KEY_LENGTH,
-                                          .limit    = SOFTDEVICE_KEY_LENGTH,
-                                          .value    = &(control->value.lock) };
+  if ( (write->offset == 0) && (write->len == sizeof(unsigned char)) ) switch ( write->data[ 0 ] ) {
 
-  if ( lock ) { memcpy ( &(control->value.lock), lock, SOFTDEVICE_KEY_LENGTH ); }
-  if ( lock ) for ( unsigned char n = 0; n < SOFTDEVICE_KEY_LENGTH; ++ n ) { if ( control->value.lock[ n ] ) return ( NRF_ERROR_FORBIDDEN ); }
+    case CONTROL_COMMAND_MEASURE: ctl_notice ( control->notice + CONTROL_NOTICE_MEASURE ); break;
+    default:                      break;
 
-  return ( softble_characteristic_declare ( control->service, BLE_ATTR_PROTECTED | BLE_ATTR_WRITE, uuid, &(data) ) );
+    }
 
   }
 
 //-----------------------------------------------------------------------------
-//  function: control_opened_characteristic ( control, opened )
+//  function: control_locate ( control, connection, write )
 // arguments: control - service resource
-//            opened - initialization value
-//   returns: NRF_ERROR_INVALID_PARAM - if parameters are invalid or missing
-//            NRF_SUCCESS - if added
+//            connection - connection handle
+//            write - write information structure
+//   returns: nothing
 //
-// Register the UUID opened characteristic with the GATT service. This is only
-// writable if the UUID is blank.
+// A gateway or reader has written the location of the tag.
 //-----------------------------------------------------------------------------
 
-static unsigned control_opened_characteristic ( control_t * control, void * opened ) {
+static void control_locate ( control_t * control, unsigned short connection, ble_gatts_evt_write_t * write ) {
+
+  if ( (write->offset == 0) && (write->len == sizeof(control_location_t)) ) { ctl_notice ( control->notice + CONTROL_NOTICE_LOCATION ); }
+
+  }
 
-  const void *                   uuid = control_id ( CONTROL_OPENED_UUID );
-  softble_characteristic_t       data = { .handles  = &(control->handle.opened),
-                                          .length   = SOFTDEVICE_KEY_LENGTH,
-                                          .limit    = SOFTDEVICE_KEY_LENGTH,
-                                          .value    = &(control->value.opened) };
-  unsigned char            attributes = BLE_ATTR_PROTECTED | BLE_ATTR_WRITE | BLE_ATTR_READ;
+//-----------------------------------------------------------------------------
+//  function: control_retrieve ( control, connection, write )
+// arguments: control - service resource
+//            connection - connection handle
+//            write - write information structure
+//   returns: nothing
+//
+// Archived location characteristic write hook. A record index written to the
+// characteristic requests that record from the location archive.
+//-----------------------------------------------------------------------------
 
-  if ( opened ) { memcpy ( &(control->value.opened), opened, SOFTDEVICE_KEY_LENGTH ); }
-  if ( opened ) for ( unsigned char n = 0; n < SOFTDEVICE_KEY_LENGTH; ++ n ) { if ( control->value.opened[ n ] ) attributes &= ~(BLE_ATTR_WRITE); }
+static void control_retrieve ( control_t * control, unsigned short connection, ble_gatts_evt_write_t * write ) {
 
-  return ( softble_characteristic_declare ( control->service, attributes, uuid, &(data) ) );
+  if ( write->len == sizeof(short) ) { control_fetch ( control, connection, *((unsigned short *) write->data) ); }
 
   }
 
 //-----------------------------------------------------------------------------
-//  function: control_closed_characteristic ( control, closed )
+//  function: control_fetch ( control, connection, index )
 // arguments: control - service resource
-//            closed - initialization value
-//   returns: NRF_ERROR_INVALID_PARAM - if parameters are invalid or missing
-//            NRF_SUCCESS - if added
+//            connection - connection handle of the requesting peer
+//            index - location record index
+//   returns: NRF_SUCCESS if successful
 //
-// Register the UUID closed characteristic with the GATT service. This is only
-// writable if the UUID is blank.
+// Retrieve the location record from the archive and post it to the archived
+// location characteristic with notification.
 //-----------------------------------------------------------------------------
 
-static unsigned control_closed_characteristic ( control_t * control, void * closed ) {
+static unsigned control_fetch ( control_t * control, unsigned short connection, unsigned short index ) {
+
+  file_handle_t               archive = file_open ( CONTROL_LOCATION_ARCHIVE, FILE_MODE_READ );
+  unsigned short               handle = control->handle.record.value_handle;
+  unsigned                     result = NRF_ERROR_NULL;
+
+  if ( archive > FILE_OK ) {
+
+    control_record_t           record = { 0 };
+    int                        offset = sizeof(control_record_t) * index;
+
+    if ( (offset == file_seek ( archive, FILE_SEEK_POSITION, offset ))
+      && (sizeof(control_record_t) == file_read ( archive, &(record), sizeof(control_record_t) )) ) { result = NRF_SUCCESS; }
 
-  const void *                   uuid = control_id ( CONTROL_CLOSED_UUID );
-  softble_characteristic_t       data = { .handles  = &(control->handle.closed),
-                                          .length   = SOFTDEVICE_KEY_LENGTH,
-                                          .limit    = SOFTDEVICE_KEY_LENGTH,
-                                          .value    = &(control->value.closed) };
-  unsigned char            attributes = BLE_ATTR_PROTECTED | BLE_ATTR_WRITE | BLE_ATTR_READ;
+    if ( NRF_SUCCESS == result ) { result = softble_characteristic_update ( handle, &(record), 0, sizeof(control_record_t) ); }
+    if ( NRF_SUCCESS == result ) { gatt_notify ( &(control->gatt), CONTROL_LINK_RECORD, connection ); }
 
-  if ( closed ) { memcpy ( &(control->value.closed), closed, SOFTDEVICE_KEY_LENGTH ); }
-  if ( closed ) for ( unsigned char n = 0; n < SOFTDEVICE_KEY_LENGTH; ++ n ) { if ( control->value.closed[ n ] ) attributes &= ~(BLE_ATTR_WRITE); }
+    file_close ( archive );
 
-  return ( softble_characteristic_declare ( control->service, attributes, uuid, &(data) ) );
+    }
+
+  return ( result );
 
   }
 
 //-----------------------------------------------------------------------------
-//  function: control_window_characteristic ( control )
+//  function: control_authorize ( control, connection, request )
 // arguments: control - service resource
-//   returns: NRF_ERROR_INVALID_PARAM - if parameters are invalid or missing
-//            NRF_SUCCESS - if added
+//            connection - connection handle
+//            request - authorization request structure
+//   returns: NRF_SUCCESS if processed
 //
-// Register the tracking window characteristic with the GATT service. This is
-// a read-only characteristic containing the time stamps in UTC.
+// Validate a bulk settings write. An accepted blob is stored, the tracking
+// node and lock are taken over immediately and a notice is issued so that the
+// application can apply the remaining settings in one step. A rejected blob
+// is refused with an ATT error and nothing is changed.
 //-----------------------------------------------------------------------------
 
-static unsigned control_window_characteristic ( control_t * control ) {
+static unsigned control_authorize ( control_t * control, unsigned short connection, ble_gatts_evt_rw_authorize_request_t * request ) {
+
+  ble_gatts_rw_authorize_reply_params_t reply = { .type = BLE_GATTS_AUTHORIZE_TYPE_WRITE };
+  ble_gatts_evt_write_t *       write = &(request->request.write);
+
+  // Only write requests to the bulk settings characteristic are of interest.
+
+  if ( request->type != BLE_GATTS_AUTHORIZE_TYPE_WRITE ) return ( NRF_SUCCESS );
+  if ( write->handle != control->handle.settings.value_handle ) return ( NRF_SUCCESS );
+
+  ctl_mutex_lock_uc ( &(control->mutex) );
+
+  // Validate the request and, if valid, have the stack update the value.
+
+  if ( BLE_GATT_STATUS_SUCCESS == (reply.params.write.gatt_status = control_validate ( control, write )) ) {
+
+    reply.params.write.update         = 1;
+    reply.params.write.offset         = write->offset;
+    reply.params.write.len            = write->len;
+    reply.params.write.p_data         = write->data;
+
+    }
+
+  // Reply to the peer and, if the blob was accepted, take it over.
 
-  const void *                   uuid = control_id ( CONTROL_WINDOW_UUID );
-  softble_characteristic_t       data = { .handles  = &(control->handle.window),
-                                          .length   = sizeof(control_window_t),
-                                          .limit    = sizeof(control_window_t),
-                                          .value    = &(control->value.window) };
+  if ( NRF_SUCCESS == bluetooth_authorize ( connection, &(reply) ) ) {
 
-  return ( softble_characteristic_declare ( control->service, BLE_ATTR_READ, uuid, &(data) ) );
+    if ( reply.params.write.update ) {
+
+      memcpy ( &(control->value.settings), write->data, sizeof(control_settings_t) );
+      memcpy ( &(control->value.node), &(control->value.settings.node), sizeof(hash_t) );
+
+      if ( ! control_blank ( control->value.settings.lock ) ) { memcpy ( control->value.lock, control->value.settings.lock, SOFTDEVICE_KEY_LENGTH ); }
+
+      softble_characteristic_update ( control->handle.node.value_handle, &(control->value.node), 0, sizeof(hash_t) );
+      ctl_notice ( control->notice + CONTROL_NOTICE_SETTINGS );
+
+      }
+
+    }
+
+  // Authorization processed.
+
+  return ( ctl_mutex_unlock ( &(control->mutex) ), NRF_SUCCESS );
 
   }
 
 //-----------------------------------------------------------------------------
-//  function: control_summary_characteristic ( control )
+//  function: control_validate ( control, write )
 // arguments: control - service resource
-//   returns: NRF_ERROR_INVALID_PARAM - if parameters are invalid or missing
-//            NRF_SUCCESS - if added
+//            write - write information structure
+//   returns: BLE_GATT_STATUS_SUCCESS if the blob is acceptable, otherwise the
+//            ATT error status with which to reject it
 //
-// Register the status flags characteristic with the GATT service.
+// Check a pending bulk settings write. The blob must be written whole in one
+// request (which requires an ATT MTU large enough to hold it), carry the
+// current version and checksum, hold limits in order and telemetry intervals
+// within range. An established lock can only be re-written with itself.
+//-----------------------------------------------------------------------------
+
+static unsigned short control_validate ( control_t * control, ble_gatts_evt_write_t * write ) {
+
+  control_settings_t         settings;
+
+  // Partial or prepared writes are not permitted.
+
+  if ( write->op != BLE_GATTS_OP_WRITE_REQ ) return ( BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED );
+  if ( write->offset ) return ( BLE_GATT_STATUS_ATTERR_INVALID_OFFSET );
+  if ( write->len != sizeof(control_settings_t) ) return ( BLE_GATT_STATUS_ATTERR_INVALID_ATT_VAL_LENGTH );
+
+  memcpy ( &(settings), write->data, sizeof(control_settings_t) );
+
+  // Check the version and the checksum.
+
+  if ( settings.version != CONTROL_SETTINGS_VERSION ) return ( CONTROL_STATUS_VERSION );
+  if ( settings.checksum != control_checksum ( &(settings), offsetof(control_settings_t, checksum) ) ) return ( CONTROL_STATUS_CHECKSUM );
+
+  // An established lock cannot be replaced.
+
+  if ( ! control_blank ( control->value.lock ) && ! control_blank ( settings.lock ) && memcmp ( control->value.lock, settings.lock, SOFTDEVICE_KEY_LENGTH ) ) return ( BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED );
+
+  // Range check the settings (written so that NaN fails the checks).
+
+  if ( ! (settings.surface.lower <= settings.surface.upper) ) return ( BLE_GATT_STATUS_ATTERR_CPS_OUT_OF_RANGE );
+
+  if ( ! (settings.atmosphere.lower.temperature <= settings.atmosphere.upper.temperature) ) return ( BLE_GATT_STATUS_ATTERR_CPS_OUT_OF_RANGE );
+  if ( ! (settings.atmosphere.lower.humidity <= settings.atmosphere.upper.humidity) ) return ( BLE_GATT_STATUS_ATTERR_CPS_OUT_OF_RANGE );
+  if ( ! (settings.atmosphere.lower.pressure <= settings.atmosphere.upper.pressure) ) return ( BLE_GATT_STATUS_ATTERR_CPS_OUT_OF_RANGE );
+
+  if ( ! ((settings.handling.force >= 0) && (settings.handling.angle >= 0)) ) return ( BLE_GATT_STATUS_ATTERR_CPS_OUT_OF_RANGE );
+
+  if ( ! ((settings.telemetry.interval >= TELEMETRY_INTERVAL_MINIMUM) && (settings.telemetry.interval <= TELEMETRY_INTERVAL_MAXIMUM)) ) return ( BLE_GATT_STATUS_ATTERR_CPS_OUT_OF_RANGE );
+  if ( ! ((settings.telemetry.archival >= 0) && (settings.telemetry.archival <= TELEMETRY_ARCHIVAL_MAXIMUM)) ) return ( BLE_GATT_STATUS_ATTERR_CPS_OUT_OF_RANGE );
+  if ( settings.telemetry.archival && (settings.telemetry.archival < settings.telemetry.interval) ) return ( BLE_GATT_STATUS_ATTERR_CPS_OUT_OF_RANGE );
+
+  // Blob is acceptable.
+
+  return ( BLE_GATT_STATUS_SUCCESS );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: control_checksum ( data, size )
+// arguments: data - data to check
+//            size - size of data in bytes
+//   returns: CRC-16 (CCITT, initial value 0xFFFF) of the data
+//-----------------------------------------------------------------------------
+
+static unsigned short control_checksum ( const void * data, unsigned size ) {
+
+  const unsigned char *          byte = data;
+  unsigned short                  crc = 0xFFFF;
+
+  while ( size -- ) {
+
+    crc                               = crc ^ (unsigned short) (*(byte ++) << 8);
+
+    for ( unsigned char bit = 0; bit < 8; ++ bit ) { crc = (crc & 0x8000) ? (unsigned short) ((crc << 1) ^ 0x1021) : (unsigned short) (crc << 1); }
+
+    }
+
+  return ( crc );
+
+  }
+
+
+//-----------------------------------------------------------------------------
+//  function: control_blank ( key )
+// arguments: key - key to check (128-bit)
+//   returns: non-zero if the key is blank
 //-----------------------------------------------------------------------------
 
-static unsigned control_summary_characteristic ( control_t * control ) {
+static unsigned char control_blank ( const unsigned char * key ) {
 
-  const void *                   uuid = control_id ( CONTROL_SUMMARY_UUID );
-  softble_characteristic_t       data = { .handles  = &(control->handle.summary),
-                                          .length   = sizeof(control_summary_t),
-                                          .limit    = sizeof(control_summary_t),
-                                          .value    = &(control->value.summary) };
+  for ( unsigned char n = 0; n < SOFTDEVICE_KEY_LENGTH; ++ n ) { if ( key[ n ] ) return ( 0 ); }
 
-  return ( softble_characteristic_declare ( control->service, BLE_ATTR_NOTIFY | BLE_ATTR_READ, uuid, &(data) ) );
+  return ( 1 );
 
   }
@@ -43,6 +43,17 @@ typedef   struct __attribute__ (( packed )) {
 
           } control_summary_t;
 
+//-----------------------------------------------------------------------------
+// Location changes are logged with their UTC time to the location archive.
+//-----------------------------------------------------------------------------
+
+typedef   struct __attribute__ (( packed )) {                                   // Location archive record:
+
+          unsigned                    time;                                     //  UTC time stamp
+          control_location_t          location;                                 //  Location context
+
+          } control_record_t;
+
 //-----------------------------------------------------------------------------
 // Service resource
 //-----------------------------------------------------------------------------
@@ -50,7 +61,8 @@ typedef   struct __attribute__ (( packed )) {
 typedef   struct {
 
           CTL_MUTEX_t                 mutex;                                    // Access mutex
-          unsigned short              service;                                  // Service handle
+          CTL_NOTICE_t                notice [ CONTROL_NOTICES ];               // Service notices
+          gatt_service_t              gatt;                                     // Service table
 
           struct {                                                              // Characteristic handles:
 
@@ -62,6 +74,13 @@ typedef   struct {
             ble_gatts_char_handles_t  window;                                   //  Tracking time window
 
             ble_gatts_char_handles_t  summary;                                  //  Summary characteristic
+            ble_gatts_char_handles_t  settings;                                 //  Bulk settings characteristic
+            ble_gatts_char_handles_t  database;                                 //  Database signature characteristic
+            ble_gatts_char_handles_t  command;                                  //  Command characteristic
+            ble_gatts_char_handles_t  measurement;                              //  Combined measurement characteristic
+            ble_gatts_char_handles_t  location;                                 //  Location context characteristic
+            ble_gatts_char_handles_t  record;                                   //  Archived location characteristic
+            ble_gatts_char_handles_t  count;                                    //  Location record count characteristic
 
             } handle;
 
@@ -75,24 +94,51 @@ typedef   struct {
             control_window_t          window;                                   // Tracking window
 
             control_summary_t         summary;                                  // Summary status
+            control_settings_t        settings;                                 // Bulk settings
+            hash_t                    database;                                 // Database signature
+            unsigned char             command;                                  // Command
+            control_measurement_t     measurement;                              // Combined measurement
+            control_location_t        location;                                 // Location context
+            control_record_t          record;                                   // Archived location
+            unsigned short            count;                                    // Location record count
 
             } value;
 
           } control_t;
 
 static    unsigned                    control_event ( control_t * control, ble_evt_t * event );
-static    unsigned                    control_write ( control_t * control, unsigned short connection, ble_gatts_evt_write_t * write );
+
+static    unsigned                    control_start ( control_t * control, unsigned short connection, ble_gap_evt_connected_t * connected );
+static    unsigned                    control_close ( control_t * control, unsigned short connection, ble_gap_evt_disconnected_t * disconnected );
+static    unsigned char               control_blank ( const unsigned char * key );
 
 //-----------------------------------------------------------------------------
-// The node and lock can be used to secure the tracking beacon.
+// Characteristic table entries, in registration order.
+//-----------------------------------------------------------------------------
+
+#define   CONTROL_ENTRY_NODE          (0)                                       // Tracking node
+#define   CONTROL_ENTRY_LOCK          (1)                                       // Tracking lock
+#define   CONTROL_ENTRY_OPENED        (2)                                       // Tracking opened
+#define   CONTROL_ENTRY_CLOSED        (3)                                       // Tracking closed
+#define   CONTROL_ENTRY_WINDOW        (4)                                       // Tracking window
+#define   CONTROL_ENTRY_SUMMARY       (5)                                       // Summary status
+#define   CONTROL_ENTRY_SETTINGS      (6)                                       // Bulk settings
+#define   CONTROL_ENTRY_DATABASE      (7)                                       // Database signature
+#define   CONTROL_ENTRY_COMMAND       (8)                                       // Command
+#define   CONTROL_ENTRY_MEASUREMENT   (9)                                       // Combined measurement
+#define   CONTROL_ENTRY_LOCATION      (10)                                      // Location context
+#define   CONTROL_ENTRY_RECORD        (11)                                      // Archived location
+#define   CONTROL_ENTRY_COUNT         (12)                                      // Location record count
+#define   CONTROL_ENTRIES             (13)
+
+//-----------------------------------------------------------------------------
+// The node and lock can be used to secure the tracking beacon. The lock is
+// only included while it is empty.
 //-----------------------------------------------------------------------------
 
 #define   CONTROL_NODE_UUID           (0x5678546e)                              // 32-bit characteristic UUID component (VxTn)
 #define   CONTROL_LOCK_UUID           (0x5678546c)                              // 32-bit characteristic UUID component (VxTl)
 
-static    unsigned                    control_node_characteristic ( control_t * control, void * node );
-static    unsigned                    control_lock_characteristic ( control_t * control, void * lock );
-
 //-----------------------------------------------------------------------------
 // The opened and closed signatures are used to open and close the tracking
 // window. They can only be written once.
@@ -102,17 +148,79 @@ static    unsigned                    control_lock_characteristic ( control_t *
 #define   CONTROL_CLOSED_UUID         (0x56785463)                              // 32-bit characteristic UUID component (VxTc)
 #define   CONTROL_WINDOW_UUID         (0x56785477)                              // 32-bit characteristic UUID component (VxTw)
 
-static    unsigned                    control_opened_characteristic ( control_t * control, void * opened );
-static    unsigned                    control_closed_characteristic ( control_t * control, void * closed );
-static    unsigned                    control_window_characteristic ( control_t * control );
-
 //-----------------------------------------------------------------------------
 // The summary characteristic is a read-only value used to report basic status.
 //-----------------------------------------------------------------------------
 
 #define   CONTROL_SUMMARY_UUID        (0x56784975)                              // 32-bit characteristic UUID component (VxSu)
+#define   CONTROL_LINK_SUMMARY        (1 << 0)                                  // Summary notification subscription
+
+//-----------------------------------------------------------------------------
+// The bulk settings characteristic reads and writes the provisioning settings
+// in a single round trip. Writes are authorized so that a blob with the wrong
+// version, a bad checksum or out of range settings can be refused.
+//-----------------------------------------------------------------------------
+
+#define   CONTROL_SETTINGS_UUID       (0x56785373)                              // 32-bit characteristic UUID component (VxSs)
+
+#define   CONTROL_STATUS_VERSION      (BLE_GATT_STATUS_ATTERR_APP_BEGIN + 0)    // ATT error: unsupported settings version
+#define   CONTROL_STATUS_CHECKSUM     (BLE_GATT_STATUS_ATTERR_APP_BEGIN + 1)    // ATT error: settings checksum mismatch
+
+//-----------------------------------------------------------------------------
+// The database signature characteristic is a read-only value identifying the
+// layout of the whole attribute database. A central which cached the handles
+// of a device can read it by UUID in a single request and skip service
+// discovery when it matches.
+//
+// The signature is advisory: the device keeps no bonds and never indicates
+// Service Changed, so a layout change (such as a firmware update or another
+// product variant) is not announced to a central which cached the handles.
+// A caching central must therefore read and compare the signature on every
+// connection, before it uses any cached handle, and rediscover the services
+// whenever it differs.
+//-----------------------------------------------------------------------------
+
+#define   CONTROL_DATABASE_UUID       (0x56784468)                              // 32-bit characteristic UUID component (VxDh)
+
+//-----------------------------------------------------------------------------
+// Writing the measure command to the command characteristic requests an
+// immediate, out of cycle measurement of every sensor. The combined result
+// is notified through the measurement characteristic once it is ready.
+//-----------------------------------------------------------------------------
+
+#define   CONTROL_COMMAND_UUID        (0x5678436d)                              // 32-bit characteristic UUID component (VxCm)
+#define   CONTROL_MEASUREMENT_UUID    (0x56784d72)                              // 32-bit characteristic UUID component (VxMr)
+#define   CONTROL_LINK_MEASUREMENT    (1 << 1)                                  // Measurement notification subscription
+
+static    void                        control_command ( control_t * control, unsigned short connection, ble_gatts_evt_write_t * write );
+
+//-----------------------------------------------------------------------------
+// The location characteristic is written by gateways and readers which see
+// the tag. It is protected like the other writable control characteristics,
+// so only an authorized peer can place the tag.
+//-----------------------------------------------------------------------------
+
+#define   CONTROL_LOCATION_UUID       (0x56784c63)                              // 32-bit characteristic UUID component (VxLc)
+#define   CONTROL_LOCATION_ARCHIVE    "internal:archive/location.rec"           // Location archive file
+
+static    void                        control_locate ( control_t * control, unsigned short connection, ble_gatts_evt_write_t * write );
+
+//-----------------------------------------------------------------------------
+// Archived location characteristics. Writing a record index to the record
+// characteristic fetches that record from the location archive.
+//-----------------------------------------------------------------------------
+
+#define   CONTROL_COUNT_UUID          (0x56784c6e)                              // 32-bit characteristic UUID component (VxLn)
+#define   CONTROL_RECORD_UUID         (0x56784c72)                              // 32-bit characteristic UUID component (VxLr)
+#define   CONTROL_LINK_RECORD         (1 << 2)                                  // Archived location notification subscription
+#define   CONTROL_LINK_COUNT          (1 << 3)                                  // Record count notification subscription
+
+static    void                        control_retrieve ( control_t * control, unsigned short connection, ble_gatts_evt_write_t * write );
+static    unsigned                    control_fetch ( control_t * control, unsigned short connection, unsigned short index );
 
-static    unsigned                    control_summary_characteristic ( control_t * control );
+static    unsigned                    control_authorize ( control_t * control, unsigned short connection, ble_gatts_evt_rw_authorize_request_t * request );
+static    unsigned short              control_validate ( control_t * control, ble_gatts_evt_write_t * write );
+static    unsigned short              control_checksum ( const void * data, unsigned size );
 
 //=============================================================================
 #endif
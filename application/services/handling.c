@@ -12,6 +12,7 @@
 #include  <stickershock.h>
 
 #include  "bluetooth.h"
+#include  "gatt.h"
 #include  "handling.h"
 
 //=============================================================================
@@ -24,6 +25,21 @@
 
 static    handling_t         resource = { 0 };
 
+//-----------------------------------------------------------------------------
+// Declare the service characteristic table, in registration order.
+//-----------------------------------------------------------------------------
+
+static    gatt_characteristic_t       characteristics [ ] = {
+
+  { .uuid = HANDLING_VALUE_UUID, .attributes = BLE_ATTR_NOTIFY | BLE_ATTR_READ, .link = HANDLING_LINK_VALUE, .options = GATT_OPTION_RESIDENT,
+    .length = sizeof(handling_values_t), .limit = sizeof(handling_values_t), .value = &(resource.value.value), .handles = &(resource.handle.value) },
+  { .uuid = HANDLING_LIMIT_UUID, .attributes = BLE_ATTR_PROTECTED | BLE_ATTR_WRITE | BLE_ATTR_READ,
+    .length = sizeof(handling_values_t), .limit = sizeof(handling_values_t), .value = &(resource.value.limit), .handles = &(resource.handle.limit) },
+  { .uuid = HANDLING_STREAM_UUID, .attributes = BLE_ATTR_VARIABLE | BLE_ATTR_NOTIFY, .link = HANDLING_LINK_STREAM,
+    .limit = sizeof(handling_batch_t), .value = &(resource.value.stream), .handles = &(resource.handle.stream) },
+
+  };
+
 //-----------------------------------------------------------------------------
 //  function: handling_uuid ( )
 // arguments: none
@@ -56,20 +72,16 @@ unsigned handling_register ( handling_values_t * limit ) {
 
   // Initialize the service resource.
 
-  if ( handling->service == BLE_GATT_HANDLE_INVALID ) { ctl_mutex_init ( &(handling->mutex) ); }
+  if ( handling->gatt.service == BLE_GATT_HANDLE_INVALID ) { ctl_mutex_init ( &(handling->mutex) ); }
   else return ( NRF_ERROR_INVALID_STATE );
 
   if ( limit ) { memcpy ( &(handling->value.limit), limit, sizeof(handling_values_t) ); }
 
+
   // Register the service with the soft device low energy stack and add the
   // service characteristics.
 
-  if ( (handling->service = softble_server_register ( BLE_GATTS_SRVC_TYPE_PRIMARY, handling_uuid ( ) )) ) {
-
-    if ( NRF_SUCCESS == result) { result = handling_value_characteristic ( handling ); }
-    if ( NRF_SUCCESS == result) { result = handling_limit_characteristic ( handling ); }
-
-    } else return ( NRF_ERROR_RESOURCES );
+  result = gatt_register ( &(handling->gatt), &(handling->mutex), handling_uuid ( ), characteristics, sizeof(characteristics) / sizeof(gatt_characteristic_t), handling, (gatt_subscribe_t) handling_subscribe );
 
   // Request a subcription to the soft device event publisher.
 
@@ -85,17 +97,55 @@ unsigned handling_register ( handling_values_t * limit ) {
 //  function: handling_settings ( limit )
 // arguments: limit - limits to use
 //   returns: NRF_SUCCESS - if retrieved
+//            NRF_ERROR_INVALID_STATE - if service is not registered
 //
-// Get the limit settings.
+// Get the limit settings. The limits are left untouched if the service has
+// not been registered.
 //-----------------------------------------------------------------------------
 
 unsigned handling_settings ( handling_values_t * limit ) {
 
   handling_t *               handling = &(resource);
   
+  // Make sure that the service has been registered with the stack.
+
+  if ( handling->gatt.service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(handling->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
   if ( limit ) { memcpy ( limit, &(handling->value.limit), sizeof(handling_values_t) ); }
 
-  return ( NRF_SUCCESS );
+  return ( ctl_mutex_unlock ( &(handling->mutex) ), NRF_SUCCESS );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: handling_configure ( limit )
+// arguments: limit - limits to use
+//   returns: NRF_SUCCESS - if updated
+//            NRF_ERROR_INVALID_STATE - if service is not registered
+//
+// Replace the limit settings and update the limit characteristic.
+//-----------------------------------------------------------------------------
+
+unsigned handling_configure ( handling_values_t * limit ) {
+
+  handling_t *               handling = &(resource);
+  unsigned                     result = NRF_SUCCESS;
+
+  if ( ! limit ) return ( NRF_ERROR_NULL );
+
+  // Make sure that the service has been registered with the stack.
+
+  if ( handling->gatt.service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(handling->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  memcpy ( &(handling->value.limit), limit, sizeof(handling_values_t) );
+
+  result = softble_characteristic_update ( handling->handle.limit.value_handle, &(handling->value.limit), 0, sizeof(handling_values_t) );
+
+  // Return with the result.
+
+  return ( ctl_mutex_unlock ( &(handling->mutex) ), result );
 
   }
 
@@ -116,15 +166,134 @@ unsigned handling_observed ( handling_values_t * values ) {
 
   // Make sure that the requested notice is valid and register the notice.
 
-  if ( handling->service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(handling->mutex) ); }
+  if ( handling->gatt.service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(handling->mutex) ); }
   else return ( NRF_ERROR_INVALID_STATE );
 
-  // Update the angle value and issue a notify to any connected peers.
+  // Update the resident values, which peers read directly, and notify them
+  // only if a peer has subscribed.
 
-  unsigned short               handle = handling->handle.value.value_handle;
-  unsigned                     result = softble_characteristic_update ( handle, values, 0, sizeof(handling_values_t) );
+  memcpy ( &(handling->value.value), values, sizeof(handling_values_t) );
 
-  if ( NRF_SUCCESS == result ) { softble_characteristic_notify ( handle, BLE_CONN_HANDLE_ALL ); }
+  unsigned                     result = gatt_mark ( &(handling->gatt), HANDLING_LINK_VALUE );
+
+  // Return with the result.
+
+  return ( ctl_mutex_unlock ( &(handling->mutex) ), result );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: handling_notice ( notice, set, events )
+// arguments: notice - the notice index to enable or disable
+//            set - event set to trigger (NULL to disable)
+//            events - event bits to set
+//   returns: NRF_SUCCESS - if notice enabled
+//            NRF_ERROR_INVALID_PARAM - if the notice index is not valid
+//
+// Register for notices with the handling service.
+//-----------------------------------------------------------------------------
+
+unsigned handling_notice ( handling_notice_t notice, CTL_EVENT_SET_t * set, CTL_EVENT_SET_t events ) {
+
+  handling_t *               handling = &(resource);
+
+  // Make sure that the requested notice is valid and register the notice.
+
+  if ( notice < HANDLING_NOTICES ) { ctl_mutex_lock_uc ( &(handling->mutex) ); }
+  else return ( NRF_ERROR_INVALID_PARAM );
+
+  handling->notice[ notice ].set      = set;
+  handling->notice[ notice ].events   = events;
+
+  // Notice registered.
+
+  return ( ctl_mutex_unlock ( &(handling->mutex) ), NRF_SUCCESS );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: handling_streaming ( limit )
+// arguments: limit - receives the number of samples per batch (0 = off)
+//   returns: NRF_SUCCESS - if retrieved
+//            NRF_ERROR_INVALID_STATE - if service is not registered
+//
+// Determine whether any peer is subscribed to the raw motion stream and, if
+// so, how many samples fit into a single notification at the smallest MTU
+// exchanged with the subscribed peers.
+//-----------------------------------------------------------------------------
+
+unsigned handling_streaming ( unsigned * limit ) {
+
+  handling_t *               handling = &(resource);
+  unsigned                      count = 0;
+
+  // Make sure that the service has been registered with the stack.
+
+  if ( handling->gatt.service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(handling->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  // The batch must fit within the notification payload (MTU less the
+  // notification and batch headers).
+
+  unsigned short                  mtu = gatt_mtu ( &(handling->gatt), HANDLING_LINK_STREAM );
+
+  if ( mtu ) {
+
+    count                             = (mtu - 3 - 3) / sizeof(movement_sample_t);
+    count                             = (count < HANDLING_STREAM_BATCH) ? count : HANDLING_STREAM_BATCH;
+
+    }
+
+  if ( limit ) { *(limit) = count; }
+
+  // Return with result.
+
+  return ( ctl_mutex_unlock ( &(handling->mutex) ), NRF_SUCCESS );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: handling_stream ( samples, count )
+// arguments: samples - raw motion samples
+//            count - number of samples
+//   returns: NRF_SUCCESS - if notified
+//            NRF_ERROR_INVALID_STATE - if no peer is subscribed
+//
+// Notify a batch of raw motion samples to the subscribed peers.
+//-----------------------------------------------------------------------------
+
+unsigned handling_stream ( movement_sample_t * samples, unsigned count ) {
+
+  handling_t *               handling = &(resource);
+  unsigned                     result = NRF_ERROR_INVALID_STATE;
+
+  if ( ! samples ) return ( NRF_ERROR_NULL );
+  if ( count > HANDLING_STREAM_BATCH ) { count = HANDLING_STREAM_BATCH; }
+
+  // Make sure that the service has been registered with the stack.
+
+  if ( handling->gatt.service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(handling->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  // Pack the samples behind the batch header and notify the peers. The
+  // sequence number advances even when a notification queue is full so that
+  // the peers can detect dropped batches.
+
+  if ( gatt_subscribed ( &(handling->gatt), HANDLING_LINK_STREAM ) ) {
+
+    unsigned short             handle = handling->handle.stream.value_handle;
+    unsigned short             length = sizeof(short) + sizeof(char) + (count * sizeof(movement_sample_t));
+
+    handling->value.stream.sequence   = handling->value.stream.sequence + 1;
+    handling->value.stream.count      = (unsigned char) count;
+
+    memcpy ( handling->value.stream.sample, samples, count * sizeof(movement_sample_t) );
+
+    if ( NRF_SUCCESS == (result = softble_characteristic_update ( handle, &(handling->value.stream), 0, length )) ) {
+      result = gatt_notify ( &(handling->gatt), HANDLING_LINK_STREAM, BLE_CONN_HANDLE_ALL );
+      }
+
+    }
 
   // Return with the result.
 
@@ -150,82 +319,69 @@ static unsigned handling_event ( handling_t * handling, ble_evt_t * event ) {
   
   switch ( event->header.evt_id ) {
     
-    case BLE_GATTS_EVT_WRITE:     return handling_write ( handling, event->evt.gatts_evt.conn_handle, &(event->evt.gatts_evt.params.write) );
-
-    default:                      return ( NRF_SUCCESS );
+    case BLE_GAP_EVT_CONNECTED:   return handling_start ( handling, event->evt.gap_evt.conn_handle, &(event->evt.gap_evt.params.connected) );
+    case BLE_GAP_EVT_DISCONNECTED:return handling_close ( handling, event->evt.gap_evt.conn_handle, &(event->evt.gap_evt.params.disconnected) );
+    default:                      return gatt_event ( &(handling->gatt), event );
 
     }
 
   }
 
 //-----------------------------------------------------------------------------
-//  function: handling_write ( handling, connection, write )
+//  function: handling_start ( handling, connection, connected )
 // arguments: handling - service resource
 //            connection - connection handle
-//            write - write information structure
+//            connected - connected information structure
 //   returns: NRF_SUCCESS if processed
 //
-// Handle service characteristic write reqests.
+// Connection to a peer has been established. Attach the link; the handling
+// values are resident and never need to be posted.
 //-----------------------------------------------------------------------------
 
-static unsigned handling_write ( handling_t * handling, unsigned short connection, ble_gatts_evt_write_t * write ) {
-
-  // For protected characteristics, the write data needs to be transferred
-  // directly to the value data.
+static unsigned handling_start ( handling_t * handling, unsigned short connection, ble_gap_evt_connected_t * connected ) {
 
-  if ( write->handle == handling->handle.limit.value_handle ) { memcpy ( (void *) &(handling->value.limit) + write->offset, write->data, write->len ); }
+  ctl_mutex_lock_uc ( &(handling->mutex) );
 
-  // Write processed.
+  gatt_attach ( &(handling->gatt), connection );
 
-  return ( NRF_SUCCESS );
+  return ( ctl_mutex_unlock ( &(handling->mutex) ), NRF_SUCCESS );
 
   }
 
-
-//=============================================================================
-// SECTION : SERVICE CHARACTERISITC DECLARATIONS
-//=============================================================================
-
 //-----------------------------------------------------------------------------
-//  function: handling_value_characteristic ( handling )
+//  function: handling_close ( handling, connection, disconnected )
 // arguments: handling - service resource
-//   returns: NRF_ERROR_INVALID_PARAM - if parameters are invalid or missing
-//            NRF_SUCCESS - if added
+//            connection - connection handle
+//            disconnected - disconnected information structure
+//   returns: NRF_SUCCESS if processed
 //
-// Register the value characteristic with the GATT service. This is a read-only
-// structure with values for force, angle and current orientation.
+// Connection to a peer has been lost. Release its link and, if the peer was
+// subscribed to the raw motion stream, issue a notice so that the stream can
+// be stopped once no subscribers remain.
 //-----------------------------------------------------------------------------
 
-static unsigned handling_value_characteristic ( handling_t * handling ) {
+static unsigned handling_close ( handling_t * handling, unsigned short connection, ble_gap_evt_disconnected_t * disconnected ) {
 
-  const void *                   uuid = handling_id ( HANDLING_VALUE_UUID );
-  softble_characteristic_t       data = { .handles  = &(handling->handle.value),
-                                          .length   = sizeof(handling_values_t),
-                                          .limit    = sizeof(handling_values_t),
-                                          .value    = &(handling->value.value) };
+  ctl_mutex_lock_uc ( &(handling->mutex) );
 
-  return ( softble_characteristic_declare ( handling->service, BLE_ATTR_NOTIFY | BLE_ATTR_READ, uuid, &(data) ) );
+  if ( gatt_detach ( &(handling->gatt), connection ) & HANDLING_LINK_STREAM ) { ctl_notice ( handling->notice + HANDLING_NOTICE_STREAM ); }
+
+  return ( ctl_mutex_unlock ( &(handling->mutex) ), NRF_SUCCESS );
 
   }
 
 //-----------------------------------------------------------------------------
-//  function: handling_limit_characteristic ( handling )
+//  function: handling_subscribe ( handling, connection, link )
 // arguments: handling - service resource
-//   returns: NRF_ERROR_INVALID_PARAM - if parameters are invalid or missing
-//            NRF_SUCCESS - if added
+//            connection - connection handle
+//            link - characteristic link bit
 //
-// Register the value characteristic with the GATT service. This is a read-write
-// structure with values for force, angle and preferred orientation.
+// Subscription hook. A change to the raw motion stream subscription issues a
+// notice so that the stream can be started or stopped.
 //-----------------------------------------------------------------------------
 
-static unsigned handling_limit_characteristic ( handling_t * handling ) {
+static void handling_subscribe ( handling_t * handling, unsigned short connection, unsigned char link ) {
 
-  const void *                   uuid = handling_id ( HANDLING_LIMIT_UUID );
-  softble_characteristic_t       data = { .handles  = &(handling->handle.limit),
-                                          .length   = sizeof(handling_values_t),
-                                          .limit    = sizeof(handling_values_t),
-                                          .value    = &(handling->value.limit) };
+  if ( link & HANDLING_LINK_STREAM ) { ctl_notice ( handling->notice + HANDLING_NOTICE_STREAM ); }
 
-  return ( softble_characteristic_declare ( handling->service, BLE_ATTR_PROTECTED | BLE_ATTR_WRITE | BLE_ATTR_READ, uuid, &(data) ) );
-  
   }
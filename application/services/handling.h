@@ -20,6 +20,18 @@
 
 static    const void *                handling_id ( unsigned service );
 
+//-----------------------------------------------------------------------------
+// Raw motion stream batch.
+//-----------------------------------------------------------------------------
+
+typedef   struct __attribute__ (( packed )) {                                   // Stream batch:
+
+          unsigned short              sequence;                                 //  Batch sequence number
+          unsigned char               count;                                    //  Number of samples in batch
+          movement_sample_t           sample [ HANDLING_STREAM_BATCH ];         //  Sample data
+
+          } handling_batch_t;
+
 //-----------------------------------------------------------------------------
 // Service resource
 //-----------------------------------------------------------------------------
@@ -27,12 +39,14 @@ static    const void *                handling_id ( unsigned service );
 typedef   struct {
           
           CTL_MUTEX_t                 mutex;                                    // Access mutex
-          unsigned short              service;                                  // Service handle
+          CTL_NOTICE_t                notice [ HANDLING_NOTICES ];              // Service notices
+          gatt_service_t              gatt;                                     // Service table
 
           struct {                                                              // Characteristic handles:
 
             ble_gatts_char_handles_t  value;                                    //  Handling values
             ble_gatts_char_handles_t  limit;                                    //  Handling limits
+            ble_gatts_char_handles_t  stream;                                   //  Raw motion stream
 
             } handle;
 
@@ -40,13 +54,24 @@ typedef   struct {
 
             handling_values_t         value;                                    //  Handling values
             handling_values_t         limit;                                    //  Handling limits
+            handling_batch_t          stream;                                   //  Raw motion stream batch
 
             } value;
 
           } handling_t;
 
 static    unsigned                    handling_event ( handling_t * handling, ble_evt_t * event );
-static    unsigned                    handling_write ( handling_t * handling, unsigned short connection, ble_gatts_evt_write_t * write );
+
+static    unsigned                    handling_start ( handling_t * handling, unsigned short connection, ble_gap_evt_connected_t * connected );
+static    unsigned                    handling_close ( handling_t * handling, unsigned short connection, ble_gap_evt_disconnected_t * disconnected );
+
+//-----------------------------------------------------------------------------
+// The handling values are resident and only notified while a peer has
+// subscribed. The stream is only pushed to the stack while a peer is linked.
+//-----------------------------------------------------------------------------
+
+#define   HANDLING_LINK_VALUE         (1 << 0)                                  // Handling values (resident)
+#define   HANDLING_LINK_STREAM        (1 << 1)                                  // Raw motion stream
 
 //-----------------------------------------------------------------------------
 // Measurement value and limit characteristics
@@ -55,8 +80,14 @@ static    unsigned                    handling_write ( handling_t * handling, un
 #define   HANDLING_VALUE_UUID         (0x48614D76)                              // 32-bit characteristic UUID component (HaMv)
 #define   HANDLING_LIMIT_UUID         (0x48614C76)                              // 32-bit characteristic UUID component (HaLv)
 
-static    unsigned                    handling_value_characteristic ( handling_t * handling );
-static    unsigned                    handling_limit_characteristic ( handling_t * handling );
+//-----------------------------------------------------------------------------
+// Raw motion stream characteristic (notify only). Subscribing to the stream
+// starts it and unsubscribing stops it.
+//-----------------------------------------------------------------------------
+
+#define   HANDLING_STREAM_UUID        (0x48615273)                              // 32-bit characteristic UUID component (HaRs)
+
+static    void                        handling_subscribe ( handling_t * handling, unsigned short connection, unsigned char link );
 
 //=============================================================================
 #endif
@@ -12,6 +12,7 @@
 #include  <stickershock.h>
 
 #include  "bluetooth.h"
+#include  "gatt.h"
 #include  "telemetry.h"
 
 //=============================================================================
@@ -24,6 +25,20 @@
 
 static    telemetry_t        resource = { 0 };
 
+//-----------------------------------------------------------------------------
+// Declare the service characteristic table, in registration order. Writes to
+// both characteristics are authorized so that they can be validated.
+//-----------------------------------------------------------------------------
+
+static    gatt_characteristic_t       characteristics [ ] = {
+
+  { .uuid = TELEMETRY_INTERVAL_UUID, .attributes = BLE_ATTR_PROTECTED | BLE_ATTR_AUTHORIZE | BLE_ATTR_WRITE | BLE_ATTR_READ,
+    .length = sizeof(float), .limit = sizeof(float), .value = &(resource.value.interval), .handles = &(resource.handle.interval) },
+  { .uuid = TELEMETRY_ARCHIVAL_UUID, .attributes = BLE_ATTR_PROTECTED | BLE_ATTR_AUTHORIZE | BLE_ATTR_WRITE | BLE_ATTR_READ,
+    .length = sizeof(float), .limit = sizeof(float), .value = &(resource.value.archival), .handles = &(resource.handle.archival) },
+
+  };
+
 //-----------------------------------------------------------------------------
 //  function: telemetry_uuid ( )
 // arguments: none
@@ -57,18 +72,16 @@ unsigned telemetry_register ( float interval, float archival ) {
 
   // Initialize the service resource.
 
-  if ( telemetry->service == BLE_GATT_HANDLE_INVALID ) { ctl_mutex_init ( &(telemetry->mutex) ); }
+  if ( telemetry->gatt.service == BLE_GATT_HANDLE_INVALID ) { ctl_mutex_init ( &(telemetry->mutex) ); }
   else return ( NRF_ERROR_INVALID_STATE );
 
+  telemetry->value.interval           = interval;
+  telemetry->value.archival           = archival;
+
   // Register the service with the soft device low energy stack and add the
   // service characteristics.
 
-  if ( (telemetry->service = softble_server_register ( BLE_GATTS_SRVC_TYPE_PRIMARY, telemetry_uuid ( ) )) ) {
-
-    if ( NRF_SUCCESS == result ) { result = telemetry_interval_characteristic ( telemetry, interval ); }
-    if ( NRF_SUCCESS == result ) { result = telemetry_archival_characteristic ( telemetry, archival ); }
-
-    } else return ( NRF_ERROR_RESOURCES );
+  result = gatt_register ( &(telemetry->gatt), &(telemetry->mutex), telemetry_uuid ( ), characteristics, sizeof(characteristics) / sizeof(gatt_characteristic_t), telemetry, NULL );
 
   // Request a subcription to the soft device event publisher.
 
@@ -93,10 +106,76 @@ unsigned telemetry_settings ( float * interval, float * archival ) {
 
   telemetry_t *             telemetry = &(resource);
   
+  // Make sure that the service has been registered with the stack.
+
+  if ( telemetry->gatt.service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(telemetry->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
   if ( interval ) { *(interval) = telemetry->value.interval; }
   if ( archival ) { *(archival) = telemetry->value.archival; }
 
-  return ( NRF_SUCCESS );
+  return ( ctl_mutex_unlock ( &(telemetry->mutex) ), NRF_SUCCESS );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: telemetry_configure ( interval, archival )
+// arguments: interval - measurement interval (seconds)
+//            archival - recording interval (seconds)
+//   returns: NRF_SUCCESS - if updated
+//            NRF_ERROR_INVALID_STATE - if service is not registered
+//
+// Replace the interval settings and update the characteristics.
+//-----------------------------------------------------------------------------
+
+unsigned telemetry_configure ( float interval, float archival ) {
+
+  telemetry_t *             telemetry = &(resource);
+  unsigned                     result = NRF_SUCCESS;
+
+  // Make sure that the service has been registered with the stack.
+
+  if ( telemetry->gatt.service != BLE_GATT_HANDLE_INVALID ) { ctl_mutex_lock_uc ( &(telemetry->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  telemetry->value.interval           = interval;
+  telemetry->value.archival           = archival;
+
+  if ( NRF_SUCCESS == result ) { result = softble_characteristic_update ( telemetry->handle.interval.value_handle, &(telemetry->value.interval), 0, sizeof(float) ); }
+  if ( NRF_SUCCESS == result ) { result = softble_characteristic_update ( telemetry->handle.archival.value_handle, &(telemetry->value.archival), 0, sizeof(float) ); }
+
+  // Return with the result.
+
+  return ( ctl_mutex_unlock ( &(telemetry->mutex) ), result );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: telemetry_notice ( notice, set, events )
+// arguments: notice - the notice index to enable or disable
+//            set - event set to trigger (NULL to disable)
+//            events - event bits to set
+//   returns: NRF_SUCCESS - if notice enabled
+//            NRF_ERROR_INVALID_PARAM - if the notice index is not valid
+//
+// Register for notices with the telemetry service.
+//-----------------------------------------------------------------------------
+
+unsigned telemetry_notice ( telemetry_notice_t notice, CTL_EVENT_SET_t * set, CTL_EVENT_SET_t events ) {
+
+  telemetry_t *             telemetry = &(resource);
+
+  // Make sure that the requested notice is valid and register the notice.
+
+  if ( notice < TELEMETRY_NOTICES ) { ctl_mutex_lock_uc ( &(telemetry->mutex) ); }
+  else return ( NRF_ERROR_INVALID_PARAM );
+
+  telemetry->notice[ notice ].set     = set;
+  telemetry->notice[ notice ].events  = events;
+
+  // Notice registered.
+
+  return ( ctl_mutex_unlock ( &(telemetry->mutex) ), NRF_SUCCESS );
 
   }
 
@@ -118,90 +197,110 @@ static unsigned telemetry_event ( telemetry_t * telemetry, ble_evt_t * event ) {
   
   switch ( event->header.evt_id ) {
     
-    case BLE_GATTS_EVT_WRITE:     return telemetry_write ( telemetry, event->evt.gatts_evt.conn_handle, &(event->evt.gatts_evt.params.write) );
+    case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+                                  return telemetry_authorize ( telemetry, event->evt.gatts_evt.conn_handle, &(event->evt.gatts_evt.params.authorize_request) );
 
-    default:                      return ( NRF_SUCCESS );
+    default:                      return gatt_event ( &(telemetry->gatt), event );
 
     }
 
   }
 
 //-----------------------------------------------------------------------------
-//  function: telemetry_write ( telemetry, connection, write )
+//  function: telemetry_authorize ( telemetry, connection, request )
 // arguments: telemetry - service resource
 //            connection - connection handle
-//            write - write information structure
+//            request - authorization request structure
 //   returns: NRF_SUCCESS if processed
 //
-// Handle service characteristic write reqests.
+// Validate a write to the interval or archival characteristic. A valid write
+// is accepted, stored and a reconfiguration notice is issued so that the new
+// timing takes effect immediately. An invalid write is rejected with an ATT
+// error and the stored settings are left untouched.
 //-----------------------------------------------------------------------------
 
-static unsigned telemetry_write ( telemetry_t * telemetry, unsigned short connection, ble_gatts_evt_write_t * write ) {
+static unsigned telemetry_authorize ( telemetry_t * telemetry, unsigned short connection, ble_gatts_evt_rw_authorize_request_t * request ) {
 
-  // For protected characteristics, the write data needs to be transferred
-  // directly to the value data.
+  ble_gatts_rw_authorize_reply_params_t reply = { .type = BLE_GATTS_AUTHORIZE_TYPE_WRITE };
+  ble_gatts_evt_write_t *       write = &(request->request.write);
+  gatt_characteristic_t * characteristic = gatt_lookup ( &(telemetry->gatt), write->handle );
 
-  if ( write->handle == telemetry->handle.interval.value_handle ) { memcpy ( (void *) &(telemetry->value.interval) + write->offset, write->data, write->len ); }
-  if ( write->handle == telemetry->handle.archival.value_handle ) { memcpy ( (void *) &(telemetry->value.archival) + write->offset, write->data, write->len ); }
+  // Only write requests to the telemetry characteristics are of interest.
 
-  // Write processed.
+  if ( request->type != BLE_GATTS_AUTHORIZE_TYPE_WRITE ) return ( NRF_SUCCESS );
+  if ( ! characteristic ) return ( NRF_SUCCESS );
 
-  return ( NRF_SUCCESS );
+  ctl_mutex_lock_uc ( &(telemetry->mutex) );
 
-  }
+  // Validate the request and, if valid, have the stack update the value.
 
+  if ( BLE_GATT_STATUS_SUCCESS == (reply.params.write.gatt_status = telemetry_validate ( telemetry, write )) ) {
 
-//=============================================================================
-// SECTION : SERVICE CHARACTERISITC DECLARATIONS
-//=============================================================================
+    reply.params.write.update         = 1;
+    reply.params.write.offset         = write->offset;
+    reply.params.write.len            = write->len;
+    reply.params.write.p_data         = write->data;
 
-//-----------------------------------------------------------------------------
-//  function: telemetry_interval_characteristic ( telemetry, period )
-// arguments: telemetry - service resource
-//            period - period in seconds
-//   returns: NRF_ERROR_INVALID_PARAM - if parameters are invalid or missing
-//            NRF_SUCCESS - if added
-//
-// Register the measurement interval characteristic with the GATT service. This
-// is a read-write floating point value.
-//-----------------------------------------------------------------------------
+    }
 
-static unsigned telemetry_interval_characteristic ( telemetry_t * telemetry, float period ) {
+  // Reply to the peer and, if the write was accepted, transfer the value and
+  // issue the reconfiguration notice.
 
-  const void *                   uuid = telemetry_id ( TELEMETRY_INTERVAL_UUID );
-  softble_characteristic_t       data = { .handles  = &(telemetry->handle.interval),
-                                          .length   = sizeof(float),
-                                          .limit    = sizeof(float),
-                                          .value    = &(telemetry->value.interval) };
-  
-  telemetry->value.interval           = period;
+  if ( NRF_SUCCESS == bluetooth_authorize ( connection, &(reply) ) ) {
 
-  return ( softble_characteristic_declare ( telemetry->service, BLE_ATTR_PROTECTED | BLE_ATTR_WRITE | BLE_ATTR_READ, uuid, &(data) ) );
+    if ( reply.params.write.update ) {
 
-  }
+      memcpy ( characteristic->value, write->data, write->len );
 
+      ctl_notice ( telemetry->notice + TELEMETRY_NOTICE_CHANGED );
+
+      }
+
+    }
+
+  // Authorization processed.
+
+  return ( ctl_mutex_unlock ( &(telemetry->mutex) ), NRF_SUCCESS );
+
+  }
 
 //-----------------------------------------------------------------------------
-//  function: telemetry_archival_characteristic ( telemetry, period )
+//  function: telemetry_validate ( telemetry, write )
 // arguments: telemetry - service resource
-//            period - period in seconds
-//   returns: NRF_ERROR_INVALID_PARAM - if parameters are invalid or missing
-//            NRF_SUCCESS - if added
+//            write - write information structure
+//   returns: BLE_GATT_STATUS_SUCCESS if the write is acceptable, otherwise the
+//            ATT error status with which to reject it
 //
-// Register the measurement interval characteristic with the GATT service. This
-// is a read-write floating point value.
+// Check a pending interval or archival write. Values must be complete floats,
+// within the permitted range and the archive interval, when enabled, must not
+// be shorter than the measurement interval.
 //-----------------------------------------------------------------------------
 
-static unsigned telemetry_archival_characteristic ( telemetry_t * telemetry, float period ) {
+static unsigned short telemetry_validate ( telemetry_t * telemetry, ble_gatts_evt_write_t * write ) {
 
-  const void *                   uuid = telemetry_id ( TELEMETRY_ARCHIVAL_UUID );
-  softble_characteristic_t       data = { .handles  = &(telemetry->handle.archival),
-                                          .length   = sizeof(float),
-                                          .limit    = sizeof(float),
-                                          .value    = &(telemetry->value.archival) };
-  
-  telemetry->value.archival           = period;
+  float                      interval = telemetry->value.interval;
+  float                      archival = telemetry->value.archival;
 
-  return ( softble_characteristic_declare ( telemetry->service, BLE_ATTR_PROTECTED | BLE_ATTR_WRITE | BLE_ATTR_READ, uuid, &(data) ) );
+  // Partial or prepared writes are not permitted.
+
+  if ( write->op != BLE_GATTS_OP_WRITE_REQ ) return ( BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED );
+  if ( write->offset ) return ( BLE_GATT_STATUS_ATTERR_INVALID_OFFSET );
+  if ( write->len != sizeof(float) ) return ( BLE_GATT_STATUS_ATTERR_INVALID_ATT_VAL_LENGTH );
+
+  // Apply the candidate value to the working copy of the settings.
+
+  if ( write->handle == telemetry->handle.interval.value_handle ) { memcpy ( &(interval), write->data, sizeof(float) ); }
+  if ( write->handle == telemetry->handle.archival.value_handle ) { memcpy ( &(archival), write->data, sizeof(float) ); }
+
+  // Range check the settings (written so that NaN fails the checks).
+
+  if ( ! ((interval >= TELEMETRY_INTERVAL_MINIMUM) && (interval <= TELEMETRY_INTERVAL_MAXIMUM)) ) return ( BLE_GATT_STATUS_ATTERR_CPS_OUT_OF_RANGE );
+  if ( ! ((archival >= 0) && (archival <= TELEMETRY_ARCHIVAL_MAXIMUM)) ) return ( BLE_GATT_STATUS_ATTERR_CPS_OUT_OF_RANGE );
+  if ( archival && (archival < interval) ) return ( BLE_GATT_STATUS_ATTERR_CPS_OUT_OF_RANGE );
+
+  // Write is acceptable.
+
+  return ( BLE_GATT_STATUS_SUCCESS );
+
+  }
 
-  }
\ No newline at end of file
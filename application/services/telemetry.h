@@ -27,7 +27,8 @@ static    const void *                telemetry_id ( unsigned service );
 typedef   struct {
           
           CTL_MUTEX_t                 mutex;                                    // Access mutex
-          unsigned short              service;                                  // Service handle
+          CTL_NOTICE_t                notice [ TELEMETRY_NOTICES ];             // Service notices
+          gatt_service_t              gatt;                                     // Service table
 
           struct {                                                              // Characteristic handles:
 
@@ -46,7 +47,8 @@ typedef   struct {
           } telemetry_t;
 
 static    unsigned                    telemetry_event ( telemetry_t * telemetry, ble_evt_t * event );
-static    unsigned                    telemetry_write ( telemetry_t * telemetry, unsigned short connection, ble_gatts_evt_write_t * write );
+static    unsigned                    telemetry_authorize ( telemetry_t * telemetry, unsigned short connection, ble_gatts_evt_rw_authorize_request_t * request );
+static    unsigned short              telemetry_validate ( telemetry_t * telemetry, ble_gatts_evt_write_t * write );
 
 //-----------------------------------------------------------------------------
 // Measurement interval characteristic
@@ -54,16 +56,12 @@ static    unsigned                    telemetry_write ( telemetry_t * telemetry,
 
 #define   TELEMETRY_INTERVAL_UUID     (0x54654D69)                              // 32-bit characteristic UUID component (TeMi)
 
-static    unsigned                    telemetry_interval_characteristic ( telemetry_t * telemetry, float period );
-
 //-----------------------------------------------------------------------------
 // Archive interval characteristic
 //-----------------------------------------------------------------------------
 
 #define   TELEMETRY_ARCHIVAL_UUID     (0x54654169)                              // 32-bit characteristic UUID component (TeAi)
 
-static    unsigned                    telemetry_archival_characteristic ( telemetry_t * telemetry, float period );
-
 //=============================================================================
 #endif
 
@@ -237,22 +237,44 @@ void main ( application_t * application ) {
     if ( status & APPLICATION_EVENT_DETACH ) { application_detach ( application ); }
     if ( status & APPLICATION_EVENT_PROBED ) { application_probed ( application ); }
     if ( status & APPLICATION_EVENT_EXPIRE ) { application_expire ( application ); }
+    if ( status & APPLICATION_EVENT_PROVISION ) { application_provision ( application ); }
+    if ( status & APPLICATION_EVENT_LOCATED ) { application_located ( application ); }
+    if ( status & APPLICATION_EVENT_CADENCE ) { application_cadence ( application ); }
 
-    // Periodic telemetry and archiving events.
+    // Periodic telemetry and archiving events, and movement related events.
+    // Beacon record changes made while handling them are folded into a
+    // single rebuild of the advertisement.
+
+    beacon_update_begin ( );
 
     if ( status & APPLICATION_EVENT_TELEMETRY ) { application_telemetry ( application ); }
     if ( status & APPLICATION_EVENT_ARCHIVE ) { application_archive ( application ); }
+    if ( status & APPLICATION_EVENT_RETIMED ) { application_retimed ( application ); }
+
+    // On-demand measurement events.
+
+    if ( status & APPLICATION_EVENT_MEASURE ) { application_measure ( application ); }
+    if ( status & APPLICATION_EVENT_AMBIENT ) { application_ambient ( application ); }
+    if ( status & APPLICATION_EVENT_SURFACE ) { application_surface ( application ); }
 
     // Movement related events.
 
     if ( status & APPLICATION_EVENT_HANDLING ) { application_handling ( application ); }
     if ( status & APPLICATION_EVENT_ORIENTED ) { application_oriented ( application ); }
 
+    beacon_update_commit ( );
+
+    // Raw motion stream events.
+
+    if ( status & APPLICATION_EVENT_STREAM ) { application_stream ( application ); }
+    if ( status & APPLICATION_EVENT_SAMPLES ) { application_samples ( application ); }
+
     // Incident handling.
 
     if ( status & APPLICATION_EVENT_STRESSED ) { application_stressed ( application ); }
     if ( status & APPLICATION_EVENT_DROPPED ) { application_dropped ( application ); }
     if ( status & APPLICATION_EVENT_TILTED ) { application_tilted ( application ); }
+    if ( status & APPLICATION_EVENT_SUBSIDE ) { application_subside ( application ); }
 
     }
 
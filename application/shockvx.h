@@ -21,8 +21,10 @@
 
           unsigned                    sensors_start ( unsigned option );
           unsigned                    sensors_begin ( float interval, float archival );
+          unsigned                    sensors_adjust ( float interval, float archival );
           unsigned                    sensors_cease ( void );
           unsigned                    sensors_close ( void );
+          unsigned                    sensors_measure ( void );
 
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
@@ -30,6 +32,7 @@
 typedef   enum {                                                                // Module notices:
           SENSORS_NOTICE_TELEMETRY,                                             //  telemetry updated
           SENSORS_NOTICE_ARCHIVE,                                               //  archive requested
+          SENSORS_NOTICE_MEASURED,                                              //  out of cycle measurement ready
           SENSORS_NOTICES
           } sensors_notice_t;
 
@@ -51,6 +54,7 @@ typedef   enum {
           unsigned                    movement_begin ( float interval );
           unsigned                    movement_cease ( void );
           unsigned                    movement_close ( void );
+          unsigned                    movement_measure ( void );
 
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
@@ -63,6 +67,8 @@ typedef   enum {
           MOVEMENT_NOTICE_STOPPED,                                              //  movement activity stopped
           MOVEMENT_NOTICE_STRESS,                                               //  excessive force detected
           MOVEMENT_NOTICE_TILT,                                                 //  excessive tilt detected
+          MOVEMENT_NOTICE_SAMPLES,                                              //  raw sample batch available
+          MOVEMENT_NOTICE_MEASURED,                                             //  out of cycle measurement ready
           MOVEMENT_NOTICES
           } movement_notice_t;
 
@@ -72,10 +78,30 @@ typedef   enum {
 //-----------------------------------------------------------------------------
 
           unsigned                    movement_temperature ( float * temperature );
+          unsigned                    movement_activity ( bool * active );
           unsigned                    movement_forces ( float * force, float * x, float * y, float * z );
           unsigned                    movement_angles ( float * angle, char * orientation );
           unsigned                    movement_limits ( float force, float angle );
 
+//-----------------------------------------------------------------------------
+// Raw motion sample stream. Each sample from the motion unit is quantized and
+// queued while streaming is enabled and a notice is issued once a full batch
+// is available.
+//-----------------------------------------------------------------------------
+
+#define   MOVEMENT_LINEAR_SCALE       ((float) 2048.0)                          // Linear acceleration LSB per g (+/- 16g)
+#define   MOVEMENT_ANGULAR_SCALE      ((float) 16.0)                            // Angular rotation LSB per degree/second
+
+typedef   struct __attribute__ (( packed )) {                                   // Raw motion sample:
+
+          signed short                linear [ 3 ];                             //  Linear acceleration (x, y, z)
+          signed short                angular [ 3 ];                            //  Angular rotation (x, y, z)
+
+          } movement_sample_t;
+
+          unsigned                    movement_stream ( unsigned batch );
+          unsigned                    movement_samples ( movement_sample_t * samples, unsigned * count );
+
 
 //=============================================================================
 // SECTION : SYSTEM STATUS MONITOR
@@ -24,6 +24,7 @@
 
 static CTL_TASK_t *            thread = NULL;
 static beacon_t              resource = { 0 };
+static bool                subscribed = false;
 
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
@@ -44,6 +45,13 @@ unsigned beacon_start ( unsigned short variant ) {
 
     beacon->record.horizon            = BEACON_POWER_HORIZON;
     beacon->record.variant.type       = variant;
+    beacon->identity.device           = *((hash_t *) NRF_FICR->DEVICEID);
+    beacon->survey.stretch            = 1.0;
+
+    // Subscribe to the stack events to hear the density survey reports.
+
+    if ( ! subscribed ) { result = softble_subscribe ( (softble_subscriber_t) beacon_event, beacon ); }
+    if ( NRF_SUCCESS == result ) { subscribed = true; }
 
     } else { result = NRF_ERROR_NO_MEM; }
 
@@ -89,6 +97,24 @@ unsigned beacon_begin ( float interval, float period, signed char power, beacon_
 
   if ( (interval >= BEACON_INTERVAL_MINIMUM) && (power <= BEACON_POWER_MAXIMUM) ) {
 
+    // A running broadcast of the same type and period is only re-timed, and
+    // only if the interval or power has changed.
+
+    if ( ((beacon->status & BEACON_STATE_RUNNING) == BEACON_STATE_RUNNING) && (type == beacon->broadcast.type) && (period == beacon->broadcast.period) ) {
+
+      if ( (interval != beacon->broadcast.interval) || (power != beacon->broadcast.power) ) {
+
+        beacon->broadcast.interval    = interval;
+        beacon->broadcast.power       = power;
+
+        ctl_events_set ( &(beacon->status), BEACON_EVENT_RETIME );
+
+        }
+
+      return ( ctl_mutex_unlock ( &(beacon->mutex) ), result );
+
+      }
+
     beacon->broadcast.interval        = interval;
     beacon->broadcast.period          = period;
     beacon->broadcast.flags           = period
@@ -97,9 +123,20 @@ unsigned beacon_begin ( float interval, float period, signed char power, beacon_
 
     beacon->broadcast.power           = power;
     beacon->broadcast.type            = type;
+    beacon->broadcast.air             = (type == BEACON_TYPE_BLE_5) ? BEACON_TYPE_BLE_5 : BEACON_TYPE_BLE_4;
 
     ctl_events_set_clear ( &(beacon->status), BEACON_EVENT_BEGIN, BEACON_CLEAR_BEGIN );
 
+    // Schedule the density survey for the broadcast, unless it was already
+    // scheduled by an earlier begin.
+
+    if ( ! (beacon->status & BEACON_STATE_SURVEYING) ) {
+
+      ctl_events_set ( &(beacon->status), BEACON_STATE_SURVEYING );
+      if ( beacon->survey.period ) { ctl_timer_start ( CTL_TIMER_CYCLICAL, &(beacon->status), BEACON_EVENT_SURVEY, (CTL_TIME_t) roundf ( beacon->survey.period * 1000.0 ) ); }
+
+      }
+
     } else { result = NRF_ERROR_INVALID_PARAM; }
 
   // Free the resource and return with the result.
@@ -115,11 +152,18 @@ unsigned beacon_cease ( void ) {
 
   beacon_t *                   beacon = &(resource);
 
-  // If the broadcast is currently active, issue a terminate request.
+  // If the broadcast is currently active, issue a terminate request and stop
+  // the frame rotation, scan response refresh and density survey.
 
   if ( thread ) {softble_advertisement_cease ( ); }
   else return ( NRF_ERROR_INVALID_STATE );
 
+  ctl_timer_clear ( &(beacon->status), BEACON_EVENT_ROTATE );
+  ctl_timer_clear ( &(beacon->status), BEACON_EVENT_REFRESH );
+  ctl_timer_clear ( &(beacon->status), BEACON_EVENT_SURVEY );
+
+  if ( beacon->status & BEACON_STATE_SCANNING ) { bluetooth_scan_cease ( ); }
+
   // Clear the state flags after ceasing.
 
   ctl_events_clear ( &(beacon->status), BEACON_CLEAR_CEASE );
@@ -205,6 +249,215 @@ unsigned beacon_network ( void * node ) {
   if ( thread ) { ctl_mutex_lock_uc ( &(beacon->mutex) ); }
   else return ( NRF_ERROR_INVALID_STATE );
 
+  // An empty node leaves the network record out of the broadcast.
+
+  if ( node ) { memcpy ( &(beacon->record.network.identity), node, sizeof(hash_t) ); }
+  else { memset ( &(beacon->record.network.identity), 0, sizeof(hash_t) ); }
+
+  beacon->networked                   = false;
+
+  for ( unsigned n = 0; n < sizeof(hash_t); ++ n ) {
+    if ( ((unsigned char *) &(beacon->record.network.identity))[ n ] ) { beacon->networked = true; break; }
+    }
+
+  // Request construction of an updated broadcast packet.
+
+  beacon_request ( beacon );
+
+  // Release the resource and return with result.
+
+  return ( ctl_mutex_unlock ( &(beacon->mutex) ), result );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: beacon_location ( location )
+// arguments: location - last known location (campus, building, floor, zone)
+//   returns: NRF_SUCCESS - if updated
+//            NRF_ERROR_INVALID_STATE - if the beacon module has not started
+//
+// Update the last known location published by the beacon. The location
+// record is left out of the broadcast until a non-zero location has been
+// set; an empty (or all-zero) location clears it.
+//-----------------------------------------------------------------------------
+
+unsigned beacon_location ( void * location ) {
+
+  beacon_t *                   beacon = &(resource);
+  unsigned                     result = NRF_SUCCESS;
+
+  // Make sure that the module has started and lock the module resource.
+
+  if ( thread ) { ctl_mutex_lock_uc ( &(beacon->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  if ( location ) { memcpy ( &(beacon->record.location), location, sizeof(broadcast_location_t) ); }
+  else { memset ( &(beacon->record.location), 0, sizeof(broadcast_location_t) ); }
+
+  beacon->located                     = false;
+
+  for ( unsigned n = 0; n < sizeof(broadcast_location_t); ++ n ) {
+    if ( ((unsigned char *) &(beacon->record.location))[ n ] ) { beacon->located = true; break; }
+    }
+
+  // Request construction of an updated broadcast packet.
+
+  beacon_request ( beacon );
+
+  // Release the resource and return with result.
+
+  return ( ctl_mutex_unlock ( &(beacon->mutex) ), result );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: beacon_schedule ( interval )
+// arguments: interval - telemetry sample interval in seconds (0 = none)
+//   returns: NRF_SUCCESS - if updated
+//            NRF_ERROR_INVALID_STATE - if the beacon module has not started
+//
+// Announce that a fresh telemetry sample has just been taken and when the
+// next one is due. The schedule record is left out while there is no
+// interval, or while the clock has not been set and the next sample cannot
+// be given a UTC time.
+//-----------------------------------------------------------------------------
+
+unsigned beacon_schedule ( float interval ) {
+
+  beacon_t *                   beacon = &(resource);
+  unsigned                     result = NRF_SUCCESS;
+  unsigned                       time = ctl_time_get ( );
+
+  // Make sure that the module has started and lock the module resource.
+
+  if ( thread ) { ctl_mutex_lock_uc ( &(beacon->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  beacon->record.schedule.interval    = (interval < 65535) ? (unsigned short) roundf ( interval ) : 65535;
+  beacon->record.schedule.next        = (time && beacon->record.schedule.interval) ? time + beacon->record.schedule.interval : 0;
+
+  // Request construction of an updated broadcast packet.
+
+  beacon_request ( beacon );
+
+  // Release the resource and return with result.
+
+  return ( ctl_mutex_unlock ( &(beacon->mutex) ), result );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: beacon_survey ( period )
+// arguments: period - survey period in seconds (0 = off)
+//   returns: NRF_SUCCESS - if the survey was scheduled
+//            NRF_ERROR_INVALID_PARAM - if the period is shorter than a window
+//            NRF_ERROR_INVALID_STATE - if the beacon module has not started
+//
+// Set the density survey period. The survey runs only while the beacon is
+// broadcasting: it is scheduled by beacon_begin and stopped by beacon_cease,
+// and the first window opens one period after the broadcast begins. Turning
+// the survey off drops any stretch of the broadcast interval.
+//-----------------------------------------------------------------------------
+
+unsigned beacon_survey ( float period ) {
+
+  beacon_t *                   beacon = &(resource);
+  unsigned                     result = NRF_SUCCESS;
+
+  // Make sure that the module has started and lock the module resource.
+
+  if ( thread ) { ctl_mutex_lock_uc ( &(beacon->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  ctl_timer_clear ( &(beacon->status), BEACON_EVENT_SURVEY );
+
+  if ( period > BEACON_SURVEY_WINDOW ) {
+
+    beacon->survey.period             = period;
+    if ( beacon->status & BEACON_STATE_SURVEYING ) { ctl_timer_start ( CTL_TIMER_CYCLICAL, &(beacon->status), BEACON_EVENT_SURVEY, (CTL_TIME_t) roundf ( period * 1000.0 ) ); }
+
+    } else if ( period == 0 ) {
+
+    beacon->survey.period             = 0;
+
+    if ( beacon->survey.stretch != 1.0 ) {
+
+      beacon->survey.stretch          = 1.0;
+      if ( (beacon->status & BEACON_STATE_RUNNING) == BEACON_STATE_RUNNING ) { ctl_events_set ( &(beacon->status), BEACON_EVENT_RETIME ); }
+
+      }
+
+    } else { result = NRF_ERROR_INVALID_PARAM; }
+
+  // Release the resource and return with result.
+
+  return ( ctl_mutex_unlock ( &(beacon->mutex) ), result );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: beacon_update_begin ( )
+// arguments: none
+//   returns: NRF_SUCCESS - if the update was opened
+//            NRF_ERROR_INVALID_STATE - if the beacon module has not started
+//
+// Open a batch of record updates. Packet construction requested by record
+// updates within the batch is held until the batch is committed, so that a
+// whole measurement cycle produces a single rebuild of the advertisement.
+// Batches may be nested; only the outermost commit releases the rebuild.
+//-----------------------------------------------------------------------------
+
+unsigned beacon_update_begin ( void ) {
+
+  beacon_t *                   beacon = &(resource);
+
+  // Make sure that the module has started and lock the module resource.
+
+  if ( thread ) { ctl_mutex_lock_uc ( &(beacon->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  beacon->update                      = beacon->update + 1;
+
+  // Release the resource and return with result.
+
+  return ( ctl_mutex_unlock ( &(beacon->mutex) ), NRF_SUCCESS );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: beacon_update_commit ( )
+// arguments: none
+//   returns: NRF_SUCCESS - if the update was committed
+//            NRF_ERROR_INVALID_STATE - if the beacon module has not started or
+//                                      no update batch is open
+//
+// Close a batch of record updates. If any record changed while the batch was
+// open, a single packet construction is requested.
+//-----------------------------------------------------------------------------
+
+unsigned beacon_update_commit ( void ) {
+
+  beacon_t *                   beacon = &(resource);
+  unsigned                     result = NRF_SUCCESS;
+
+  // Make sure that the module has started and lock the module resource.
+
+  if ( thread ) { ctl_mutex_lock_uc ( &(beacon->mutex) ); }
+  else return ( NRF_ERROR_INVALID_STATE );
+
+  // Close the batch and release any deferred construction once the outermost
+  // batch is committed.
+
+  if ( beacon->update ) { beacon->update = beacon->update - 1; }
+  else result = NRF_ERROR_INVALID_STATE;
+
+  if ( (beacon->update == 0) && (beacon->status & BEACON_STATE_DEFERRED) ) {
+
+    ctl_events_clear ( &(beacon->status), BEACON_STATE_DEFERRED );
+    beacon_request ( beacon );
+
+    }
+
   // Release the resource and return with result.
 
   return ( ctl_mutex_unlock ( &(beacon->mutex) ), result );
@@ -234,7 +487,7 @@ unsigned beacon_battery ( signed char battery ) {
 
   // Request construction of an updated broadcast packet.
 
-  if ( beacon->status & BEACON_STATE_PERIOD ) { ctl_events_set ( &(beacon->status), BEACON_EVENT_CONSTRUCT ); }
+  beacon_request ( beacon );
 
   // Release the resource and return with result.
 
@@ -261,7 +514,7 @@ unsigned beacon_ambient ( float measurement, unsigned incursion, unsigned excurs
 
   // Request construction of an updated broadcast packet.
 
-  if ( beacon->status & BEACON_STATE_PERIOD ) { ctl_events_set ( &(beacon->status), BEACON_EVENT_CONSTRUCT ); }
+  beacon_request ( beacon );
 
   // Release the resource and return with result.
 
@@ -288,7 +541,7 @@ unsigned beacon_humidity ( float measurement, unsigned incursion, unsigned excur
 
   // Request construction of an updated broadcast packet.
 
-  if ( beacon->status & BEACON_STATE_PERIOD ) { ctl_events_set ( &(beacon->status), BEACON_EVENT_CONSTRUCT ); }
+  beacon_request ( beacon );
 
   // Release the resource and return with result.
 
@@ -315,7 +568,7 @@ unsigned beacon_pressure ( float measurement, unsigned incursion, unsigned excur
 
   // Request construction of an updated broadcast packet.
 
-  if ( beacon->status & BEACON_STATE_PERIOD ) { ctl_events_set ( &(beacon->status), BEACON_EVENT_CONSTRUCT ); }
+  beacon_request ( beacon );
 
   // Release the resource and return with result.
 
@@ -342,7 +595,7 @@ unsigned beacon_temperature ( float measurement, unsigned incursion, unsigned ex
 
   // Request construction of an updated broadcast packet.
 
-  if ( beacon->status & BEACON_STATE_PERIOD ) { ctl_events_set ( &(beacon->status), BEACON_EVENT_CONSTRUCT ); }
+  beacon_request ( beacon );
 
   // Release the resource and return with result.
 
@@ -370,7 +623,7 @@ unsigned beacon_orientation ( float angle, unsigned char orientation ) {
 
   // Request construction of an updated broadcast packet.
 
-  if ( beacon->status & BEACON_STATE_PERIOD ) { ctl_events_set ( &(beacon->status), BEACON_EVENT_CONSTRUCT ); }
+  beacon_request ( beacon );
 
   // Release the resource and return with result.
 
@@ -394,6 +647,10 @@ unsigned beacon_misoriented ( void ) {
   beacon->record.handling.orientation = beacon->record.handling.orientation
                                       | BROADCAST_ORIENTATION_FACE;
 
+  // Request construction of an updated broadcast packet.
+
+  beacon_request ( beacon );
+
   // Release the resource and return with result.
 
   return ( ctl_mutex_unlock ( &(beacon->mutex) ), result );
@@ -416,6 +673,10 @@ unsigned beacon_dropped ( void ) {
   beacon->record.handling.orientation               = beacon->record.handling.orientation
                                                     | BROADCAST_ORIENTATION_DROP;
 
+  // Request construction of an updated broadcast packet.
+
+  beacon_request ( beacon );
+
   // Release the resource and return with result.
 
   return ( ctl_mutex_unlock ( &(beacon->mutex) ), result );
@@ -438,6 +699,10 @@ unsigned beacon_bumped ( void ) {
   beacon->record.handling.orientation               = beacon->record.handling.orientation
                                                     | BROADCAST_ORIENTATION_BUMP;
 
+  // Request construction of an updated broadcast packet.
+
+  beacon_request ( beacon );
+
   // Release the resource and return with result.
 
   return ( ctl_mutex_unlock ( &(beacon->mutex) ), result );
@@ -460,6 +725,10 @@ unsigned beacon_tipped ( void ) {
   beacon->record.handling.orientation               = beacon->record.handling.orientation
                                                     | BROADCAST_ORIENTATION_TILT;
 
+  // Request construction of an updated broadcast packet.
+
+  beacon_request ( beacon );
+
   // Release the resource and return with result.
 
   return ( ctl_mutex_unlock ( &(beacon->mutex) ), result );
@@ -467,6 +736,22 @@ unsigned beacon_tipped ( void ) {
   }
 
 
+//-----------------------------------------------------------------------------
+//  function: beacon_request ( beacon )
+// arguments: beacon - module resource (locked)
+//
+// Request construction of an updated broadcast packet. While an update batch
+// is open, the request is held as deferred and released by the commit.
+//-----------------------------------------------------------------------------
+
+static void beacon_request ( beacon_t * beacon ) {
+
+  if ( beacon->update ) { ctl_events_set ( &(beacon->status), BEACON_STATE_DEFERRED ); }
+  else if ( beacon->status & BEACON_STATE_PERIOD ) { ctl_events_set ( &(beacon->status), BEACON_EVENT_CONSTRUCT ); }
+
+  }
+
+
 //=============================================================================
 // SECTION : BEACON MANAGER THREAD
 //=============================================================================
@@ -491,11 +776,17 @@ static void beacon_manager ( beacon_t * beacon ) {
     // Handle broadcast construction and state change events.
 
     if ( status & BEACON_EVENT_CONFIGURE ) { beacon_configure ( beacon ); }
+    if ( status & BEACON_EVENT_RETIME ) { beacon_retime ( beacon ); }
+    if ( status & BEACON_EVENT_ROTATE ) { beacon_rotate ( beacon ); }
+    if ( status & BEACON_EVENT_REFRESH ) { beacon_refresh ( beacon ); }
+    if ( status & BEACON_EVENT_SURVEY ) { beacon_scan ( beacon ); }
+    if ( status & BEACON_EVENT_RESUME ) { beacon_resume ( beacon ); }
+    if ( status & BEACON_EVENT_SURVEYED ) { beacon_surveyed ( beacon ); }
     if ( status & BEACON_EVENT_CONSTRUCT ) { beacon_construct ( beacon ); }
     if ( status & BEACON_EVENT_BROADCAST ) { beacon_broadcast ( beacon ); }
 
-    if ( status & BEACON_EVENT_ADVERTISE ) { beacon_advertise ( beacon ); }
     if ( status & BEACON_EVENT_TERMINATE ) { beacon_terminate ( beacon ); }
+    if ( status & BEACON_EVENT_ADVERTISE ) { beacon_advertise ( beacon ); }
     if ( status & BEACON_EVENT_INSPECTED ) { beacon_inspected ( beacon ); }
 
     }
@@ -517,10 +808,11 @@ static void beacon_shutdown ( beacon_t * beacon ) {
 
   if ( NRF_SUCCESS == softble_advertisement_state ( &(enabled) ) ) { if ( enabled ) softble_advertisement_cease ( ); }
 
-  // If an advertisement has been constructed, free the buffers.
+  ctl_timer_clear ( &(beacon->status), BEACON_EVENT_ROTATE );
+  ctl_timer_clear ( &(beacon->status), BEACON_EVENT_REFRESH );
+  ctl_timer_clear ( &(beacon->status), BEACON_EVENT_SURVEY );
 
-  if ( beacon->advertisement.data ) { free ( beacon->advertisement.data ); }
-  if ( beacon->advertisement.scan ) { free ( beacon->advertisement.scan ); }
+  if ( beacon->status & BEACON_STATE_SCANNING ) { bluetooth_scan_cease ( ); }
 
   }
 
@@ -529,7 +821,10 @@ static void beacon_shutdown ( beacon_t * beacon ) {
 
 static void beacon_configure ( beacon_t * beacon ) {
 
-  if ( beacon->broadcast.type == BEACON_TYPE_BLE_5 ) { beacon_configure_ble_5 ( beacon ); }
+  ctl_timer_clear ( &(beacon->status), BEACON_EVENT_ROTATE );
+  ctl_timer_clear ( &(beacon->status), BEACON_EVENT_REFRESH );
+
+  if ( beacon->broadcast.air == BEACON_TYPE_BLE_5 ) { beacon_configure_ble_5 ( beacon ); }
   else { beacon_configure_ble_4 ( beacon ); }
   
   }
@@ -539,11 +834,48 @@ static void beacon_configure ( beacon_t * beacon ) {
 
 static void beacon_construct ( beacon_t * beacon ) {
 
+  // Bump the change sequence only when a telemetry record differs from the
+  // one last published, so that a rebuild for the identity, battery, location
+  // or schedule keeps its sequence.
+
+  if ( memcmp ( &(beacon->published.temperature), &(beacon->record.temperature), sizeof(broadcast_temperature_t) )
+    || memcmp ( &(beacon->published.atmosphere), &(beacon->record.atmosphere), sizeof(broadcast_atmosphere_t) )
+    || memcmp ( &(beacon->published.handling), &(beacon->record.handling), sizeof(broadcast_handling_t) ) ) {
+
+    memcpy ( &(beacon->published.temperature), &(beacon->record.temperature), sizeof(broadcast_temperature_t) );
+    memcpy ( &(beacon->published.atmosphere), &(beacon->record.atmosphere), sizeof(broadcast_atmosphere_t) );
+    memcpy ( &(beacon->published.handling), &(beacon->record.handling), sizeof(broadcast_handling_t) );
+
+    beacon->sequence.change           = beacon->sequence.change + 1;
+
+    }
+
   if ( beacon->broadcast.type == BEACON_TYPE_BLE_5 ) { beacon_construct_ble_5 ( beacon ); }
   else { beacon_construct_ble_4 ( beacon ); }
 
   }
 
+//-----------------------------------------------------------------------------
+// Reprogram the interval and power of the running broadcast. The advertising
+// set is stopped just long enough to take the new timing and is handed the
+// packets already constructed, without rebuilding them.
+//-----------------------------------------------------------------------------
+
+static void beacon_retime ( beacon_t * beacon ) {
+
+  unsigned char                active = beacon->advertisement.active;
+  unsigned char                 frame = beacon->advertisement.frame;
+
+  beacon_configure ( beacon );
+  beacon->advertisement.relayed       = false;
+
+  if ( beacon->broadcast.air == BEACON_TYPE_BLE_5 ) { softble_advertisement_packet ( beacon->advertisement.extended + active, NULL ); }
+  else { softble_advertisement_packet ( beacon->advertisement.data[ active ] + frame, beacon->advertisement.scan + beacon->advertisement.response ); }
+
+  beacon_broadcast ( beacon );
+
+  }
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 
@@ -552,7 +884,122 @@ static void beacon_broadcast ( beacon_t * beacon ) {
   // Open the advertisement broadcast period.
 
   if ( NRF_SUCCESS == softble_advertisement_begin ( beacon->broadcast.power ) ) { ctl_events_set ( &(beacon->status), BEACON_STATE_PERIOD ); }
-  else { ctl_events_clear ( &(beacon->status), BEACON_STATE_PERIOD ); }
+  else { ctl_events_clear ( &(beacon->status), BEACON_STATE_PERIOD ); return; }
+
+  // A BLE 4.x (or dual) broadcast moves on to the next data frame every
+  // interval and refreshes a stale scan response now and then.
+
+  if ( beacon->broadcast.type != BEACON_TYPE_BLE_5 ) {
+
+    ctl_timer_start ( CTL_TIMER_CYCLICAL, &(beacon->status), BEACON_EVENT_ROTATE, (CTL_TIME_t) roundf ( beacon_interval ( beacon ) * 1000.0 ) );
+    ctl_timer_start ( CTL_TIMER_CYCLICAL, &(beacon->status), BEACON_EVENT_REFRESH, (CTL_TIME_t) roundf ( BEACON_REFRESH_INTERVAL * 1000.0 ) );
+
+    }
+
+  }
+
+//-----------------------------------------------------------------------------
+// Hand the next prebuilt data frame of the active set to the stack. The
+// frames are only rebuilt into the other set, so the stack never sees a
+// frame change underneath it.
+//-----------------------------------------------------------------------------
+
+static void beacon_rotate ( beacon_t * beacon ) {
+
+  unsigned char                active = beacon->advertisement.active;
+  unsigned char                 frame = beacon->advertisement.frame + 1;
+
+  if ( beacon->status & BEACON_STATE_PACKET ) {
+
+    if ( frame >= beacon->advertisement.frames ) { frame = BEACON_FRAME_IDENTITY; }
+
+    // A dual broadcast hands the set to the extended packet once the frames
+    // wrap around, and back to the first frame after one interval.
+
+    if ( beacon->broadcast.type == BEACON_TYPE_DUAL ) {
+
+      if ( beacon->broadcast.air == BEACON_TYPE_BLE_5 ) { beacon_swap ( beacon, BEACON_TYPE_BLE_4 ); return; }
+      if ( frame == BEACON_FRAME_IDENTITY ) { beacon_swap ( beacon, BEACON_TYPE_BLE_5 ); return; }
+
+      }
+
+    if ( NRF_SUCCESS == softble_advertisement_packet ( beacon->advertisement.data[ active ] + frame, beacon_reply ( beacon ) ) ) {
+
+      beacon->advertisement.frame     = frame;
+      beacon->advertisement.response  = beacon->advertisement.response ^ 1;
+      beacon->advertisement.relayed   = false;
+
+      }
+
+    }
+
+  }
+
+//-----------------------------------------------------------------------------
+// Bring a stale scan response up to date. The new response is built into the
+// idle buffer and handed to the stack along with the current data frame, in
+// whichever of its buffers the stack is not using.
+//-----------------------------------------------------------------------------
+
+static void beacon_refresh ( beacon_t * beacon ) {
+
+  // While a dual broadcast is on its extended packet, the refresh waits for
+  // the BLE 4.x frames to return.
+
+  if ( beacon->broadcast.air != BEACON_TYPE_BLE_4 ) return;
+
+  if ( (beacon->status & (BEACON_STATE_STALE | BEACON_STATE_PACKET)) == (BEACON_STATE_STALE | BEACON_STATE_PACKET) ) {
+
+    softble_advertisement_t *    data = beacon_relay ( beacon );
+
+    if ( NRF_SUCCESS == softble_advertisement_packet ( data, beacon_response ( beacon ) ) ) {
+
+      beacon->advertisement.response  = beacon->advertisement.response ^ 1;
+      beacon->advertisement.relayed   = (data == &(beacon->advertisement.relay)) ? true : false;
+      ctl_events_clear ( &(beacon->status), BEACON_STATE_STALE );
+
+      }
+
+    }
+
+  }
+
+//-----------------------------------------------------------------------------
+// Hand the advertising set of a dual broadcast over to the other broadcast.
+// The set is reconfigured for the new advertising type and given the packet
+// already constructed for it, without touching the rotation timers. The stop
+// and restart of the set is masked from the advertise and terminate notices.
+//-----------------------------------------------------------------------------
+
+static void beacon_swap ( beacon_t * beacon, beacon_type_t air ) {
+
+  unsigned char                active = beacon->advertisement.active;
+
+  beacon->broadcast.air               = air;
+  beacon->advertisement.relayed       = false;
+  ctl_events_set ( &(beacon->status), BEACON_STATE_SWAPPING );
+
+  if ( air == BEACON_TYPE_BLE_5 ) {
+
+    beacon_configure_ble_5 ( beacon );
+    softble_advertisement_packet ( beacon->advertisement.extended + active, NULL );
+
+    } else {
+
+    beacon_configure_ble_4 ( beacon );
+    softble_advertisement_packet ( beacon->advertisement.data[ active ], beacon->advertisement.scan + beacon->advertisement.response );
+    beacon->advertisement.frame       = BEACON_FRAME_IDENTITY;
+
+    }
+
+  // If the set could not be restarted, the broadcast has ended after all.
+
+  if ( NRF_SUCCESS != softble_advertisement_begin ( beacon->broadcast.power ) ) {
+
+    ctl_events_clear ( &(beacon->status), BEACON_STATE_SWAPPING );
+    beacon_terminate ( beacon );
+
+    }
 
   }
 
@@ -561,6 +1008,11 @@ static void beacon_broadcast ( beacon_t * beacon ) {
 
 static void beacon_advertise ( beacon_t * beacon ) {
 
+  // The restart of a swapped set completes the swap and is not a new
+  // broadcast.
+
+  if ( beacon->status & BEACON_STATE_SWAPPING ) { ctl_events_clear ( &(beacon->status), BEACON_STATE_SWAPPING ); return; }
+
   ctl_events_set ( &(beacon->status), BEACON_STATE_ACTIVE );
   ctl_notice ( beacon->notice + BEACON_NOTICE_ADVERTISE );
 
@@ -571,6 +1023,10 @@ static void beacon_advertise ( beacon_t * beacon ) {
 
 static void beacon_terminate ( beacon_t * beacon ) {
 
+  // The stop of a swapped set is not the end of the broadcast.
+
+  if ( beacon->status & BEACON_STATE_SWAPPING ) return;
+
   ctl_events_clear ( &(beacon->status), BEACON_STATE_ACTIVE );
   ctl_notice ( beacon->notice + BEACON_NOTICE_TERMINATE );
 
@@ -582,11 +1038,104 @@ static void beacon_terminate ( beacon_t * beacon ) {
 
 static void beacon_inspected ( beacon_t * beacon ) {
 
+  // The scan response is in demand, so bring it up to date for the next
+  // scanner.
+
+  if ( beacon->status & BEACON_STATE_STALE ) { beacon_refresh ( beacon ); }
+
   ctl_notice ( beacon->notice + BEACON_NOTICE_INSPECTED );
 
   }
 
 
+//-----------------------------------------------------------------------------
+//  callback: beacon_event ( beacon, event )
+// arguments: beacon - module resource
+//            event - BLE event structure
+//   returns: NRF_SUCCESS if event processed
+//
+// Count the advertising reports of an open survey window. The stack pauses
+// the scan after each report, so the manager thread is asked to resume it.
+// The end of the window is also passed on to the manager thread.
+//-----------------------------------------------------------------------------
+
+static unsigned beacon_event ( beacon_t * beacon, ble_evt_t * event ) {
+
+  switch ( event->header.evt_id ) {
+
+    case BLE_GAP_EVT_ADV_REPORT:  ++ beacon->survey.reports;
+                                  ctl_events_set ( &(beacon->status), BEACON_EVENT_RESUME );
+                                  break;
+
+    case BLE_GAP_EVT_TIMEOUT:     if ( event->evt.gap_evt.params.timeout.src == BLE_GAP_TIMEOUT_SRC_SCAN ) { ctl_events_set ( &(beacon->status), BEACON_EVENT_SURVEYED ); }
+                                  break;
+
+    default:                      break;
+
+    }
+
+  return ( NRF_SUCCESS );
+
+  }
+
+//-----------------------------------------------------------------------------
+// Open a passive survey window. The scan never requests scan responses, so
+// the neighbourhood is not disturbed. A survey which fires while the beacon is
+// not broadcasting is skipped.
+//-----------------------------------------------------------------------------
+
+static void beacon_scan ( beacon_t * beacon ) {
+
+  if ( (beacon->status & BEACON_STATE_RUNNING) != BEACON_STATE_RUNNING ) return;
+
+  beacon->survey.reports              = 0;
+  beacon->survey.report.p_data        = beacon->survey.buffer;
+  beacon->survey.report.len           = sizeof(beacon->survey.buffer);
+
+  if ( NRF_SUCCESS == bluetooth_scan_begin ( BEACON_SURVEY_WINDOW, BEACON_SURVEY_SCAN, &(beacon->survey.report) ) ) { ctl_events_set ( &(beacon->status), BEACON_STATE_SCANNING ); }
+
+  }
+
+//-----------------------------------------------------------------------------
+// Resume the survey scan paused by an advertising report, as long as the
+// window is still open.
+//-----------------------------------------------------------------------------
+
+static void beacon_resume ( beacon_t * beacon ) {
+
+  if ( beacon->status & BEACON_STATE_SCANNING ) { bluetooth_scan_resume ( &(beacon->survey.report) ); }
+
+  }
+
+//-----------------------------------------------------------------------------
+// The survey window has closed. Work out the stretch of the broadcast
+// interval from the load heard and re-time a running broadcast when it
+// changes.
+//-----------------------------------------------------------------------------
+
+static void beacon_surveyed ( beacon_t * beacon ) {
+
+  float                          load = ((float) beacon->survey.reports) / BEACON_SURVEY_WINDOW;
+  float                       stretch = 1.0;
+
+  ctl_events_clear ( &(beacon->status), BEACON_STATE_SCANNING );
+
+  // A survey which has since been turned off leaves the interval alone.
+
+  if ( ! beacon->survey.period ) return;
+
+  if ( load > BEACON_SURVEY_LOAD ) { stretch = ceilf ( (load / BEACON_SURVEY_LOAD) * 4.0 ) / 4.0; }
+  if ( stretch > BEACON_SURVEY_STRETCH ) { stretch = BEACON_SURVEY_STRETCH; }
+
+  if ( stretch != beacon->survey.stretch ) {
+
+    beacon->survey.stretch            = stretch;
+    if ( (beacon->status & BEACON_STATE_RUNNING) == BEACON_STATE_RUNNING ) { beacon_retime ( beacon ); }
+
+    }
+
+  }
+
 //=============================================================================
 // SECTION : BEACON BROADCAST UTILITIES
 //=============================================================================
@@ -603,7 +1152,7 @@ static void beacon_configure_ble_4 ( beacon_t * beacon ) {
   // Program the duration and broadcast rate of the advertisement period and
   // register to receive notices when it expires.
 
-  if ( NRF_SUCCESS == softble_advertisement_period ( BLE_GAP_ADV_TYPE_NONCONNECTABLE_SCANNABLE_UNDIRECTED, beacon->broadcast.interval, beacon->broadcast.period ) ) {
+  if ( NRF_SUCCESS == softble_advertisement_period ( BLE_GAP_ADV_TYPE_NONCONNECTABLE_SCANNABLE_UNDIRECTED, beacon_interval ( beacon ), beacon->broadcast.period ) ) {
 
     // Set up notifications for advertisment start and stop.
 
@@ -630,17 +1179,17 @@ static void beacon_configure_ble_5 ( beacon_t * beacon ) {
   // Program the duration and broadcast rate of the advertisement period and
   // register to receive notices when it expires.
 
-  if ( NRF_SUCCESS == softble_advertisement_period ( BLE_GAP_ADV_TYPE_EXTENDED_NONCONNECTABLE_SCANNABLE_UNDIRECTED, beacon->broadcast.interval, beacon->broadcast.period ) ) {
+  // The whole beacon is carried in a single extended advertisement, so there
+  // is no scan response to be inspected. The extended set is sent on the 1M
+  // PHY; the LE Coded PHY is not available on this part.
+
+  if ( NRF_SUCCESS == softble_advertisement_period ( BLE_GAP_ADV_TYPE_EXTENDED_NONCONNECTABLE_NONSCANNABLE_UNDIRECTED, beacon_interval ( beacon ), beacon->broadcast.period ) ) {
 
     // Set up notifications for advertisment start and stop.
 
     softdevice_notice ( SOFTBLE_NOTICE_ADVERTISE_START, &(beacon->status), BEACON_EVENT_ADVERTISE );
     softdevice_notice ( SOFTBLE_NOTICE_ADVERTISE_CEASE, &(beacon->status), BEACON_EVENT_TERMINATE );
 
-    // Interested whenever the beacon broadcast is inspected.
-
-    softdevice_notice ( SOFTBLE_NOTICE_INSPECTED, &(beacon->status), BEACON_EVENT_INSPECTED );
-
     }
 
   }
@@ -650,75 +1199,90 @@ static void beacon_configure_ble_5 ( beacon_t * beacon ) {
 
 static void beacon_construct_ble_4 ( beacon_t * beacon ) {
 
-  softble_advertisement_t *      data = softble_advertisement_create ( );
-  softble_advertisement_t *      scan = softble_advertisement_create ( );
-  broadcast_packet_t *       standard = broadcast_packet ( BROADCAST_STANDARD_CODE );
-  broadcast_packet_t *       extended = broadcast_packet ( BROADCAST_EXTENDED_CODE );
-  const void *               security = access_key ( );
+  unsigned char                  next = beacon->advertisement.active ^ 1;
+  softble_advertisement_t *      data = beacon->advertisement.data[ next ];
+  softble_advertisement_t *      scan = beacon->advertisement.scan + beacon->advertisement.response;
+  bool                          fresh = (beacon->status & BEACON_STATE_PACKET) ? false : true;
+  unsigned char                frames = beacon->networked ? BEACON_FRAMES : BEACON_FRAME_NETWORK;
 
-  // Construct a stadard broadcast data packet to contain either a secure identity
-  // record or a normal identity record, depending on the presence of a key.
+  // Build each of the data frames into the set not in use by the stack. The
+  // network frame is only part of the rotation while a node is set.
 
-  if ( standard ) {
+  for ( unsigned char frame = 0; frame < frames; ++ frame ) { beacon_frame ( beacon, data + frame, frame, frames ); }
 
-    if ( security ) {
-      
-      broadcast_security_t   identity = { .timecode = ctl_time_get ( ), .identity = *((hash_t *) NRF_FICR->DEVICEID) };
-      identity.security               = hash ( security, &(identity), sizeof(unsigned) + sizeof(hash_t) );
-      identity.horizon                = beacon->record.horizon;
-      identity.battery                = beacon->record.battery;
+  // The scan response is only built along with the data frames when the
+  // broadcast is first loaded. Otherwise the current response is carried
+  // over into the idle buffer and marked stale.
 
-      broadcast_append ( standard, &(identity), sizeof(broadcast_security_t), BROADCAST_TYPE_SECURE( BROADCAST_TYPE_IDENTITY ) );
+  if ( fresh ) { scan = beacon_response ( beacon ); }
+  else if ( beacon->broadcast.air == BEACON_TYPE_BLE_4 ) { scan = beacon_reply ( beacon ); }
 
-      } else {
+  // A dual broadcast also carries the extended packet in the new set.
 
-      broadcast_identity_t   identity = { .timecode = ctl_time_get ( ), .identity = *((hash_t *) NRF_FICR->DEVICEID) };
-      identity.horizon                = beacon->record.horizon;
-      identity.battery                = beacon->record.battery;
-      
-      broadcast_append ( standard, &(identity), sizeof(broadcast_identity_t), BROADCAST_TYPE_NORMAL( BROADCAST_TYPE_IDENTITY ) );
-      
-      }
+  if ( beacon->broadcast.type == BEACON_TYPE_DUAL ) { beacon_extended ( beacon, beacon->advertisement.extended + next ); }
 
-    }
+  // Update the BLE stack with the first frame of the new set, or with the
+  // extended packet while a dual broadcast is on it. The new set only
+  // becomes active once the stack has accepted it; otherwise the stack keeps
+  // using the previous set, which is left untouched.
 
-  // Append the atmospheric telemetry information to the extended and
-  // standard packets.
+  if ( NRF_SUCCESS == ((beacon->broadcast.air == BEACON_TYPE_BLE_5) ? softble_advertisement_packet ( beacon->advertisement.extended + next, NULL ) : softble_advertisement_packet ( data, scan )) ) {
 
-  if ( extended ) { broadcast_append ( extended, &(beacon->record.atmosphere), sizeof(broadcast_atmosphere_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_ATMOSPHERE) ); }
-  if ( standard ) { broadcast_append ( standard, &(beacon->record.temperature), sizeof(broadcast_temperature_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_TEMPERATURE) ); }
+    ctl_events_set ( &(beacon->status), BEACON_STATE_PACKET );
+    beacon->advertisement.active      = next;
+    beacon->advertisement.frame       = BEACON_FRAME_IDENTITY;
+    beacon->advertisement.frames      = frames;
+    beacon->advertisement.relayed     = false;
 
-  // Add the broadcast packet to the scan data.
+    if ( scan != beacon->advertisement.scan + beacon->advertisement.response ) { beacon->advertisement.response = beacon->advertisement.response ^ 1; }
 
-  if ( data && standard ) { softble_advertisement_append ( data, BLE_GAP_AD_TYPE_SERVICE_DATA, standard, broadcast_length ( standard ) + sizeof(short) ); }
-  if ( scan && extended ) { softble_advertisement_append ( scan, BLE_GAP_AD_TYPE_SERVICE_DATA, extended, broadcast_length ( extended ) + sizeof(short) ); }
+    if ( fresh ) { ctl_events_clear ( &(beacon->status), BEACON_STATE_STALE ); }
+    else { ctl_events_set ( &(beacon->status), BEACON_STATE_STALE ); }
 
-  // If there is new advertising broadcast data, update the bluetooth
-  // stack with the new broadcast.
+    } else { ctl_events_clear ( &(beacon->status), BEACON_STATE_PACKET ); }
 
-  if ( data || scan ) {
+  }
+
+//-----------------------------------------------------------------------------
+//  function: beacon_frame ( beacon, data, frame, frames )
+// arguments: beacon - module resource
+//            data - advertisement packet to receive the frame
+//            frame - frame index
+//            frames - number of frames in the rotation
+//
+// Build one frame of the BLE 4.x rotation. Each frame is a standard broadcast
+// packet led by the frame record, except for the network frame, which leads
+// with the network record.
+//-----------------------------------------------------------------------------
 
-    // Update the BLE stack with the new advertising packet.
+static void beacon_frame ( beacon_t * beacon, softble_advertisement_t * data, unsigned char frame, unsigned char frames ) {
 
-    if ( NRF_SUCCESS == softble_advertisement_packet ( data, scan ) ) { ctl_events_set ( &(beacon->status), BEACON_STATE_PACKET ); }
-    else { ctl_events_clear ( &(beacon->status), BEACON_STATE_PACKET ); }
+  broadcast_buffer_t *       standard = &(beacon->assembly.standard);
+  broadcast_frame_t             index = { .frame = BROADCAST_FRAME( frame, frames ) };
 
-    // Free the the old advertising packet.
+  beacon_standard ( beacon, frame == BEACON_FRAME_NETWORK );
+  broadcast_append ( standard, &(index), sizeof(broadcast_frame_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_FRAME) );
 
-    free ( beacon->advertisement.data );
-    free ( beacon->advertisement.scan );
+  switch ( frame ) {
 
-    }
+    case BEACON_FRAME_IDENTITY:   beacon_identity ( beacon, standard );
+                                  break;
 
-  // Update the resource with the new advertisement records.
+    case BEACON_FRAME_SURFACE:    broadcast_append ( standard, &(beacon->sequence), sizeof(broadcast_sequence_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_SEQUENCE) );
+                                  broadcast_append ( standard, &(beacon->record.temperature), sizeof(broadcast_temperature_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_TEMPERATURE) );
+                                  broadcast_append ( standard, &(beacon->record.handling), sizeof(broadcast_handling_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_HANDLING) );
+                                  if ( beacon->located ) { broadcast_append ( standard, &(beacon->record.location), sizeof(broadcast_location_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_LOCATION) ); }
+                                  break;
 
-  beacon->advertisement.data      = data;
-  beacon->advertisement.scan      = scan;
+    case BEACON_FRAME_ATMOSPHERE: broadcast_append ( standard, &(beacon->sequence), sizeof(broadcast_sequence_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_SEQUENCE) );
+                                  broadcast_append ( standard, &(beacon->record.atmosphere), sizeof(broadcast_atmosphere_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_ATMOSPHERE) );
+                                  break;
 
-  // Discard the broadcast packet scratch buffers.
+    case BEACON_FRAME_NETWORK:    break;
 
-  free ( extended );
-  free ( standard );
+    }
+
+  softble_advertisement_append ( beacon_blank ( data ), BLE_GAP_AD_TYPE_SERVICE_DATA, &(standard->packet), broadcast_length ( standard ) + sizeof(short) );
 
   }
 
@@ -727,75 +1291,224 @@ static void beacon_construct_ble_4 ( beacon_t * beacon ) {
 
 static void beacon_construct_ble_5 ( beacon_t * beacon ) {
 
-  softble_advertisement_t *      scan = softble_advertisement_create ( );
-  broadcast_packet_t *       standard = broadcast_packet ( BROADCAST_STANDARD_CODE );
-  const void *               security = access_key ( );
+  unsigned char                  next = beacon->advertisement.active ^ 1;
+  softble_advertisement_t *      data = beacon->advertisement.extended + next;
+
+  beacon_extended ( beacon, data );
+
+  // Update the BLE stack with the new advertisement packet and make it active
+  // once the stack has accepted it.
+
+  if ( NRF_SUCCESS == softble_advertisement_packet ( data, NULL ) ) {
+
+    ctl_events_set ( &(beacon->status), BEACON_STATE_PACKET );
+    beacon->advertisement.active      = next;
+
+    } else { ctl_events_clear ( &(beacon->status), BEACON_STATE_PACKET ); }
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: beacon_extended ( beacon, data )
+// arguments: beacon - module resource
+//            data - advertisement packet to receive the broadcast
+//
+// Build the BLE 5.x extended advertisement, which carries every record in a
+// single standard broadcast packet.
+//-----------------------------------------------------------------------------
+
+static void beacon_extended ( beacon_t * beacon, softble_advertisement_t * data ) {
+
+  broadcast_buffer_t *       standard = &(beacon->assembly.standard);
+
+  beacon_standard ( beacon, true );
 
   // Construct a stadard broadcast data packet to contain either a secure identity
-  // record or a normal identity record, depending on the presence of a key.
+  // record or a normal identity record, depending on the presence of a key,
+  // followed by the variant.
+
+  beacon_identity ( beacon, standard );
+  broadcast_append ( standard, &(beacon->record.variant), sizeof(broadcast_variant_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_VARIANT) );
+
+  // Append the change sequence, the atmospheric and surface telemetry, each
+  // with its compliance times, and the handling summary to the standard packet.
+
+  broadcast_append ( standard, &(beacon->sequence), sizeof(broadcast_sequence_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_SEQUENCE) );
+  broadcast_append ( standard, &(beacon->record.atmosphere), sizeof(broadcast_atmosphere_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_ATMOSPHERE) );
+  broadcast_append ( standard, &(beacon->record.temperature), sizeof(broadcast_temperature_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_TEMPERATURE) );
+  broadcast_append ( standard, &(beacon->record.handling), sizeof(broadcast_handling_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_HANDLING) );
+
+  // Follow with the last known location and the telemetry schedule, once
+  // they have been set.
+
+  if ( beacon->located ) { broadcast_append ( standard, &(beacon->record.location), sizeof(broadcast_location_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_LOCATION) ); }
+  if ( beacon->record.schedule.next ) { broadcast_append ( standard, &(beacon->record.schedule), sizeof(broadcast_schedule_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_SCHEDULE) ); }
+
+  // Add the broadcast packet to the extended advertisement data.
+
+  softble_advertisement_append ( beacon_blank ( data ), BLE_GAP_AD_TYPE_SERVICE_DATA, &(standard->packet), broadcast_length ( standard ) + sizeof(short) );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: beacon_blank ( advertisement )
+// arguments: advertisement - advertisement packet buffer
+//   returns: the emptied advertisement packet
+//
+// Empty an advertisement packet buffer, as if freshly created, so that it can
+// be filled again.
+//-----------------------------------------------------------------------------
+
+static softble_advertisement_t * beacon_blank ( softble_advertisement_t * advertisement ) {
 
-  if ( standard ) {
+  return ( memset ( advertisement, 0, sizeof(softble_advertisement_t) ) );
 
-    if ( security ) {
-      
-      broadcast_security_t   identity = { .timecode = ctl_time_get ( ), .identity = *((hash_t *) NRF_FICR->DEVICEID) };
-      identity.security               = hash ( security, &(identity), sizeof(unsigned) + sizeof(hash_t) );
-      identity.horizon                = beacon->record.horizon;
-      identity.battery                = beacon->record.battery;
+  }
 
-      broadcast_append ( standard, &(identity), sizeof(broadcast_security_t), BROADCAST_TYPE_SECURE( BROADCAST_TYPE_IDENTITY ) );
+//-----------------------------------------------------------------------------
+//  function: beacon_identity ( beacon, buffer )
+// arguments: beacon - module resource
+//            buffer - packet buffer to append the identity record to
+//
+// Append the identity record to the packet. With a security key, the secure
+// record is taken from the cache, which is only re-hashed when the timecode
+// or the key has changed since it was built.
+//-----------------------------------------------------------------------------
+
+static void beacon_identity ( beacon_t * beacon, broadcast_buffer_t * buffer ) {
+
+  const void *               security = access_key ( );
+  unsigned                   timecode = ctl_time_get ( );
 
-      } else {
+  if ( security ) {
+
+    broadcast_security_t *   identity = &(beacon->identity.record);
+
+    if ( !(beacon->identity.secure) || (identity->timecode != timecode) || memcmp ( beacon->identity.key, security, SOFTDEVICE_KEY_LENGTH ) ) {
+
+      memcpy ( beacon->identity.key, security, SOFTDEVICE_KEY_LENGTH );
+
+      identity->timecode              = timecode;
+      identity->identity              = beacon->identity.device;
+      identity->security              = hash ( security, identity, sizeof(unsigned) + sizeof(hash_t) );
+
+      beacon->identity.secure         = true;
 
-      broadcast_identity_t   identity = { .timecode = ctl_time_get ( ), .identity = *((hash_t *) NRF_FICR->DEVICEID) };
-      identity.horizon                = beacon->record.horizon;
-      identity.battery                = beacon->record.battery;
-      
-      broadcast_append ( standard, &(identity), sizeof(broadcast_identity_t), BROADCAST_TYPE_NORMAL( BROADCAST_TYPE_IDENTITY ) );
-      
       }
 
-    // Note: not using the variant at the moment
-    // broadcast_append ( standard, &(beacon->record.variant), sizeof(broadcast_variant_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_VARIANT) );
+    identity->horizon                 = beacon->record.horizon;
+    identity->battery                 = beacon->record.battery;
+
+    broadcast_append ( buffer, identity, sizeof(broadcast_security_t), BROADCAST_TYPE_SECURE( BROADCAST_TYPE_IDENTITY ) );
+
+    } else {
+
+    broadcast_identity_t     identity = { .timecode = timecode, .identity = beacon->identity.device };
+    identity.horizon                  = beacon->record.horizon;
+    identity.battery                  = beacon->record.battery;
+
+    broadcast_append ( buffer, &(identity), sizeof(broadcast_identity_t), BROADCAST_TYPE_NORMAL( BROADCAST_TYPE_IDENTITY ) );
 
     }
 
-  // Append the atmospheric telemetry information to the standard packet.
+  }
 
-  if ( standard ) { broadcast_append ( standard, &(beacon->record.atmosphere), sizeof(broadcast_atmosphere_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_ATMOSPHERE) ); }
-  if ( standard ) { broadcast_append ( standard, &(beacon->record.temperature), sizeof(broadcast_temperature_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_TEMPERATURE) ); }
+//-----------------------------------------------------------------------------
+//  function: beacon_response ( beacon )
+// arguments: beacon - module resource
+//   returns: the scan response packet
+//
+// Build the BLE 4.x scan response, carrying the atmospheric telemetry for
+// active scanners, into the scan response buffer not in use by the stack.
+//-----------------------------------------------------------------------------
 
-  // Note: ignore handling for now
-  // if ( standard ) { broadcast_append ( standard, &(beacon->record.handling), sizeof(broadcast_handling_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_HANDLING) ); }
+static softble_advertisement_t * beacon_response ( beacon_t * beacon ) {
 
-  // Add the broadcast packet to the scan data.
+  softble_advertisement_t *      scan = beacon_blank ( beacon->advertisement.scan + (beacon->advertisement.response ^ 1) );
+  broadcast_buffer_t *       extended = &(beacon->assembly.extended);
 
-  if ( scan && standard ) { softble_advertisement_append ( scan, BLE_GAP_AD_TYPE_SERVICE_DATA, standard, broadcast_length ( standard ) + sizeof(short) ); }
+  broadcast_packet ( extended, BROADCAST_EXTENDED_CODE );
+  broadcast_append ( extended, &(beacon->record.atmosphere), sizeof(broadcast_atmosphere_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_ATMOSPHERE) );
 
-  // If there is new advertising broadcast data, update the bluetooth
-  // stack with the new broadcast.
+  softble_advertisement_append ( scan, BLE_GAP_AD_TYPE_SERVICE_DATA, &(extended->packet), broadcast_length ( extended ) + sizeof(short) );
 
-  if ( scan ) {
+  return ( scan );
 
-    // Update the BLE stack with the new advertising packet.
+  }
 
-    if ( NRF_SUCCESS == softble_advertisement_packet ( NULL, scan ) ) { ctl_events_set ( &(beacon->status), BEACON_STATE_PACKET ); }
-    else { ctl_events_clear ( &(beacon->status), BEACON_STATE_PACKET ); }
+//-----------------------------------------------------------------------------
+//  function: beacon_reply ( beacon )
+// arguments: beacon - module resource
+//   returns: the scan response packet
+//
+// Carry the current BLE 4.x scan response over into the scan response buffer
+// not in use by the stack, so that it can be handed over again while the
+// stack is advertising.
+//-----------------------------------------------------------------------------
 
-    // Free the the old advertising packet.
+static softble_advertisement_t * beacon_reply ( beacon_t * beacon ) {
 
-    free ( beacon->advertisement.data );
-    free ( beacon->advertisement.scan );
+  softble_advertisement_t *      scan = beacon->advertisement.scan + (beacon->advertisement.response ^ 1);
 
-    }
+  return ( memcpy ( scan, beacon->advertisement.scan + beacon->advertisement.response, sizeof(softble_advertisement_t) ) );
 
-  // Update the resource with the new advertisement records.
+  }
+
+//-----------------------------------------------------------------------------
+//  function: beacon_relay ( beacon )
+// arguments: beacon - module resource
+//   returns: the current data frame
+//
+// Provide the current BLE 4.x data frame in a buffer not in use by the stack:
+// the frame itself while the stack is using the relay copy, otherwise a
+// fresh relay copy of the frame.
+//-----------------------------------------------------------------------------
+
+static softble_advertisement_t * beacon_relay ( beacon_t * beacon ) {
+
+  softble_advertisement_t *      data = beacon->advertisement.data[ beacon->advertisement.active ] + beacon->advertisement.frame;
+
+  if ( beacon->advertisement.relayed ) return ( data );
+
+  return ( memcpy ( &(beacon->advertisement.relay), data, sizeof(softble_advertisement_t) ) );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: beacon_standard ( beacon, network )
+// arguments: beacon - module resource
+//            network - lead with the network record (when a node is set)
+//   returns: the standard packet under construction
+//
+// Open a new standard broadcast packet in the assembly buffer, optionally led
+// by the network record when a tracking network node has been set.
+//-----------------------------------------------------------------------------
+
+static broadcast_packet_t * beacon_standard ( beacon_t * beacon, bool network ) {
+
+  broadcast_buffer_t *       standard = &(beacon->assembly.standard);
+  broadcast_packet_t *         packet = broadcast_packet ( standard, BROADCAST_STANDARD_CODE );
+
+  if ( network && beacon->networked ) { broadcast_append ( standard, &(beacon->record.network), sizeof(broadcast_network_t), BROADCAST_TYPE_NORMAL(BROADCAST_TYPE_NETWORK) ); }
+
+  return ( packet );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: beacon_interval ( beacon )
+// arguments: beacon - module resource
+//   returns: the broadcast interval in seconds
+//
+// The broadcast interval, stretched by the density survey. An incident burst
+// (broadcast at the burst rate or quicker) is brief and must be heard at once,
+// so it is exempt from the stretch.
+//-----------------------------------------------------------------------------
 
-  beacon->advertisement.data      = NULL;
-  beacon->advertisement.scan      = scan;
+static float beacon_interval ( beacon_t * beacon ) {
 
-  // Discard the broadcast packet scratch buffers.
+  if ( beacon->broadcast.interval <= BEACON_BURST_RATE ) return ( beacon->broadcast.interval );
 
-  free ( standard );
+  return ( beacon->broadcast.interval * beacon->survey.stretch );
 
   }
@@ -22,6 +22,53 @@
 
 #define   BEACON_INTERVAL_MINIMUM     ((float) 20e-3)                           // Minimum interval is 20ms
 
+//-----------------------------------------------------------------------------
+// A BLE 4.x beacon rotates its data packet through a set of frames, moving
+// on to the next frame every broadcast interval, so that a passive observer
+// sees every record without having to request the scan response:
+//
+//   0 - identity
+//   1 - surface temperature (with compliance), handling incidents and the
+//       last known location (once set)
+//   2 - atmosphere (with compliance)
+//   3 - tracking network node (only while a node is set)
+//
+// The network record does not fit alongside the other frames' records within
+// a legacy advertisement (nor in the scan response), so it is given a frame
+// of its own, which joins the rotation only once a tracking network node has
+// been set. A gateway ties the other frames to it by advertiser address. The telemetry
+// schedule has no room in any frame and is only carried by the extended
+// packet.
+//-----------------------------------------------------------------------------
+
+#define   BEACON_FRAME_IDENTITY       (0)
+#define   BEACON_FRAME_SURFACE        (1)
+#define   BEACON_FRAME_ATMOSPHERE     (2)
+#define   BEACON_FRAME_NETWORK        (3)
+#define   BEACON_FRAMES               (4)
+
+//-----------------------------------------------------------------------------
+// Each frame, carried as service data (two byte header and packet code), must
+// fit within a legacy advertisement with all of its optional records present.
+//-----------------------------------------------------------------------------
+
+#define   BEACON_RECORD_SIZE(t)       (sizeof(broadcast_record_t) + sizeof(t))
+#define   BEACON_LEGACY_SIZE(r)       (2 + sizeof(short) + (r))
+
+_Static_assert ( BEACON_LEGACY_SIZE( BEACON_RECORD_SIZE(broadcast_frame_t) + BEACON_RECORD_SIZE(broadcast_security_t) ) <= BLE_GAP_ADV_SET_DATA_SIZE_MAX, "identity frame exceeds a legacy advertisement" );
+_Static_assert ( BEACON_LEGACY_SIZE( BEACON_RECORD_SIZE(broadcast_frame_t) + BEACON_RECORD_SIZE(broadcast_sequence_t) + BEACON_RECORD_SIZE(broadcast_temperature_t) + BEACON_RECORD_SIZE(broadcast_handling_t) + BEACON_RECORD_SIZE(broadcast_location_t) ) <= BLE_GAP_ADV_SET_DATA_SIZE_MAX, "surface frame exceeds a legacy advertisement" );
+_Static_assert ( BEACON_LEGACY_SIZE( BEACON_RECORD_SIZE(broadcast_frame_t) + BEACON_RECORD_SIZE(broadcast_sequence_t) + BEACON_RECORD_SIZE(broadcast_atmosphere_t) ) <= BLE_GAP_ADV_SET_DATA_SIZE_MAX, "atmosphere frame exceeds a legacy advertisement" );
+_Static_assert ( BEACON_LEGACY_SIZE( BEACON_RECORD_SIZE(broadcast_network_t) + BEACON_RECORD_SIZE(broadcast_frame_t) ) <= BLE_GAP_ADV_SET_DATA_SIZE_MAX, "network frame exceeds a legacy advertisement" );
+_Static_assert ( BEACON_LEGACY_SIZE( BEACON_RECORD_SIZE(broadcast_atmosphere_t) ) <= BLE_GAP_ADV_SET_DATA_SIZE_MAX, "scan response exceeds a legacy advertisement" );
+
+//-----------------------------------------------------------------------------
+// The BLE 4.x scan response is only read by active scanners, so it is not
+// rebuilt along with the data frames. It is marked stale instead and brought
+// up to date once it has been inspected, or by a slow refresh timer.
+//-----------------------------------------------------------------------------
+
+#define   BEACON_REFRESH_INTERVAL     ((float) 60.0)                            // Refresh a stale scan response every minute
+
 //-----------------------------------------------------------------------------
 // Central manager resource
 //-----------------------------------------------------------------------------
@@ -43,21 +90,39 @@ typedef   struct {
             unsigned char             flags;                                    //  Advertisement flags
             signed char               power;                                    //  Power settings
 
-            beacon_type_t             type;                                     //  Beacon type (4x or 5x)
+            beacon_type_t             type;                                     //  Beacon type (4x, 5x or dual)
+            beacon_type_t             air;                                      //  Broadcast on the air (4x or 5x)
             
             } broadcast;
 
-          struct {                                                              // Peripheral advertisement:
+          struct {                                                              // Beacon advertisement:
 
-            softble_advertisement_t * data;                                     //  Advertisement data packet
-            softble_advertisement_t * scan;                                     //  Scan response data packet
+            softble_advertisement_t   data [ 2 ][ BEACON_FRAMES ];              //  Advertisement data packet frames
+            softble_advertisement_t   scan [ 2 ];                               //  Scan response data packets
+            softble_advertisement_t   extended [ 2 ];                           //  Extended advertisement data packets
+            softble_advertisement_t   relay;                                    //  Copy of the data frame in use by the stack
+            bool                      relayed;                                  //  Stack is using the relay copy
+            unsigned char             active;                                   //  Packet set in use by the stack
+            unsigned char             response;                                 //  Scan response in use by the stack
+            unsigned char             frame;                                    //  Data frame in use by the stack
+            unsigned char             frames;                                   //  Data frames in the active set
 
             } advertisement;
 
+          struct {                                                              // Broadcast packet assembly:
+
+            broadcast_buffer_t        standard;                                 //  Standard code packet
+            broadcast_buffer_t        extended;                                 //  Extended code packet
+
+            } assembly;
+
           struct {
 
             signed char               horizon;                                  // Power horizon
             signed char               battery;                                  // Battery level            
+            broadcast_network_t       network;                                  // Tracking network node
+            broadcast_location_t      location;                                 // Last known location
+            broadcast_schedule_t      schedule;                                 // Telemetry sample schedule
             broadcast_variant_t       variant;
 
             broadcast_temperature_t   temperature;
@@ -66,6 +131,40 @@ typedef   struct {
 
             } record;
 
+          struct {                                                              // Last published telemetry:
+
+            broadcast_temperature_t   temperature;                              //  Surface temperature
+            broadcast_atmosphere_t    atmosphere;                               //  Atmosphere
+            broadcast_handling_t      handling;                                 //  Handling summary
+
+            } published;
+
+          broadcast_sequence_t        sequence;                                 // Telemetry change sequence
+          bool                        networked;                                // Network node has been set
+          bool                        located;                                  // Location has been set
+
+          struct {                                                              // Identity record cache:
+
+            hash_t                    device;                                   //  Device identity (from FICR)
+            unsigned char             key [ SOFTDEVICE_KEY_LENGTH ];            //  Security key of the cached hash
+            bool                      secure;                                   //  Cached hash is valid
+            broadcast_security_t      record;                                   //  Prebuilt secure identity record
+
+            } identity;
+
+          struct {                                                              // Density survey:
+
+            float                     period;                                   //  Survey period (0 = off)
+            float                     stretch;                                  //  Broadcast interval stretch (1 = none)
+            unsigned                  reports;                                  //  Advertisements heard in the window
+
+            unsigned char             buffer [ BLE_GAP_SCAN_BUFFER_MIN ];       //  Advertising report buffer
+            ble_data_t                report;                                   //  Advertising report data
+
+            } survey;
+
+          unsigned char               update;                                   // Open record update batches
+
           } beacon_t;
 
 static    void                        beacon_manager ( beacon_t * beacon );
@@ -84,6 +183,11 @@ static    void                        beacon_shutdown ( beacon_t * beacon );
 #define   BEACON_STATE_ACTIVE         (1 << 29)                                 // Actively advertising
 #define   BEACON_STATE_PACKET         (1 << 28)                                 // Broadcast packet loaded
 #define   BEACON_STATE_PERIOD         (1 << 27)                                 // Broadcast period defined
+#define   BEACON_STATE_DEFERRED       (1 << 26)                                 // Construction held by an update batch
+#define   BEACON_STATE_STALE          (1 << 25)                                 // Scan response is out of date
+#define   BEACON_STATE_SWAPPING       (1 << 24)                                 // Dual broadcast is swapping the set
+
+static    void                        beacon_request ( beacon_t * beacon );
 
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
@@ -96,6 +200,28 @@ static    void                        beacon_configure ( beacon_t * beacon );
 static    void                        beacon_construct ( beacon_t * beacon );
 static    void                        beacon_broadcast ( beacon_t * beacon );
 
+#define   BEACON_EVENT_RETIME         (1 << 9)                                  // Re-time the running broadcast
+#define   BEACON_EVENT_ROTATE         (1 << 8)                                  // Rotate to the next data frame
+#define   BEACON_EVENT_REFRESH        (1 << 7)                                  // Refresh a stale scan response
+
+static    void                        beacon_retime ( beacon_t * beacon );
+static    void                        beacon_rotate ( beacon_t * beacon );
+static    void                        beacon_refresh ( beacon_t * beacon );
+
+//-----------------------------------------------------------------------------
+// The SoftDevice only provides a single advertising set, so a dual beacon
+// shares it between both broadcasts: after each pass through the BLE 4.x
+// frames, the set is handed to the BLE 5.x packet for one interval.
+//
+// The advertising type of a running set cannot be changed, so each swap stops
+// the set and restarts it. Nothing is sent for the short time it takes to
+// reconfigure the set (well under one broadcast interval). The stop and start
+// are internal to the beacon, so they are not passed on as advertise and
+// terminate notices and the beacon remains active throughout.
+//-----------------------------------------------------------------------------
+
+static    void                        beacon_swap ( beacon_t * beacon, beacon_type_t air );
+
 #define   BEACON_EVENT_ADVERTISE      (1 << 12)                                 // Started advertising
 #define   BEACON_EVENT_TERMINATE      (1 << 11)                                 // Ceased advertising
 #define   BEACON_EVENT_INSPECTED      (1 << 10)                                 // Packet inspected
@@ -105,8 +231,9 @@ static    void                        beacon_terminate ( beacon_t * beacon );
 static    void                        beacon_inspected ( beacon_t * beacon );
 
 #define   BEACON_EVENT_BEGIN          (BEACON_EVENT_CONFIGURE | BEACON_EVENT_CONSTRUCT | BEACON_EVENT_BROADCAST)
-#define   BEACON_CLEAR_BEGIN          (BEACON_EVENT_ADVERTISE | BEACON_EVENT_TERMINATE | BEACON_STATE_PERIOD | BEACON_STATE_PACKET | BEACON_STATE_ACTIVE)
-#define   BEACON_CLEAR_CEASE          (BEACON_STATE_PACKET | BEACON_STATE_ACTIVE)
+#define   BEACON_CLEAR_BEGIN          (BEACON_EVENT_ADVERTISE | BEACON_EVENT_TERMINATE | BEACON_STATE_PERIOD | BEACON_STATE_PACKET | BEACON_STATE_ACTIVE | BEACON_STATE_SWAPPING)
+#define   BEACON_CLEAR_CEASE          (BEACON_STATE_PACKET | BEACON_STATE_ACTIVE | BEACON_STATE_SWAPPING | BEACON_STATE_SCANNING | BEACON_STATE_SURVEYING)
+#define   BEACON_STATE_RUNNING        (BEACON_STATE_PERIOD | BEACON_STATE_PACKET | BEACON_STATE_ACTIVE)
 
 //-----------------------------------------------------------------------------
 // Beacon support for 4.x or 5.x advertisement broadcast configuration.
@@ -122,5 +249,76 @@ static    void                        beacon_configure_ble_5 ( beacon_t * beacon
 static    void                        beacon_construct_ble_4 ( beacon_t * beacon );
 static    void                        beacon_construct_ble_5 ( beacon_t * beacon );
 
+//-----------------------------------------------------------------------------
+// Advertisement packets are double buffered in the module resource. A new
+// packet pair is built in the buffers not in use by the stack and only becomes
+// the active pair once the stack has accepted it.
+//-----------------------------------------------------------------------------
+
+static    softble_advertisement_t *   beacon_blank ( softble_advertisement_t * advertisement );
+static    void                        beacon_frame ( beacon_t * beacon, softble_advertisement_t * data, unsigned char frame, unsigned char frames );
+static    void                        beacon_extended ( beacon_t * beacon, softble_advertisement_t * data );
+static    softble_advertisement_t *   beacon_response ( beacon_t * beacon );
+
+//-----------------------------------------------------------------------------
+// While advertising, the stack only takes buffers which it is not already
+// using, so the scan response handed along with each data frame alternates
+// between its two buffers, carrying the current response over each time.
+//-----------------------------------------------------------------------------
+
+static    softble_advertisement_t *   beacon_reply ( beacon_t * beacon );
+
+//-----------------------------------------------------------------------------
+// Likewise, refreshing the scan response alone hands the current data frame
+// over again, alternating between the frame and a relay copy of it.
+//-----------------------------------------------------------------------------
+
+static    softble_advertisement_t *   beacon_relay ( beacon_t * beacon );
+
+//-----------------------------------------------------------------------------
+// The secure identity hash only depends upon the timecode, device identity
+// and security key, so it is cached and only recomputed when the timecode or
+// key changes.
+//-----------------------------------------------------------------------------
+
+static    void                        beacon_identity ( beacon_t * beacon, broadcast_buffer_t * buffer );
+
+//-----------------------------------------------------------------------------
+// The extended packet and the BLE 4.x network frame lead with the network
+// record once a tracking network node has been set.
+//-----------------------------------------------------------------------------
+
+static    broadcast_packet_t *        beacon_standard ( beacon_t * beacon, bool network );
+
+//-----------------------------------------------------------------------------
+// The density survey opens a passive scan window of one second, scanning each
+// advertising channel in turn, and counts the advertising reports heard. The
+// count approximates the advertising events per second of the neighbourhood.
+// A legacy advertisement occupies a channel for about 0.4 ms, so keeping the
+// chance of a collision near 10% allows about 130 events per second. Above
+// that load the broadcast interval is stretched in proportion, in quarter
+// steps and up to eight times, so that every tag in a crowded room backs off
+// together; the controller's own random advertising delay keeps the tags from
+// locking in step. The survey only runs between beacon_begin and beacon_cease
+// and never scans while the beacon is not broadcasting.
+//-----------------------------------------------------------------------------
+
+#define   BEACON_SURVEY_WINDOW        ((float) 1.0)                             // Passive scan window (seconds)
+#define   BEACON_SURVEY_SCAN          ((float) 100e-3)                          // Scan interval and window (seconds)
+#define   BEACON_SURVEY_LOAD          ((float) 130.0)                           // Neighbourhood load kept without stretching (events per second)
+#define   BEACON_SURVEY_STRETCH       ((float) 8.0)                             // Longest stretch of the broadcast interval
+
+#define   BEACON_EVENT_SURVEY         (1 << 6)                                  // Open a survey window
+#define   BEACON_EVENT_SURVEYED       (1 << 5)                                  // Survey window has closed
+#define   BEACON_EVENT_RESUME         (1 << 4)                                  // Resume the paused survey scan
+#define   BEACON_STATE_SCANNING       (1 << 23)                                 // Survey window is open
+#define   BEACON_STATE_SURVEYING      (1 << 22)                                 // Broadcast begun, survey scheduled
+
+static    unsigned                    beacon_event ( beacon_t * beacon, ble_evt_t * event );
+static    void                        beacon_scan ( beacon_t * beacon );
+static    void                        beacon_resume ( beacon_t * beacon );
+static    void                        beacon_surveyed ( beacon_t * beacon );
+static    float                       beacon_interval ( beacon_t * beacon );
+
 //=============================================================================
 #endif
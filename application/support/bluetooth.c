@@ -21,7 +21,18 @@
 // note: the system does not use a low frequency clock
 //-----------------------------------------------------------------------------
 
-unsigned bluetooth_start ( const char * label ) {
+unsigned bluetooth_start ( const char * label, unsigned services ) {
+
+  // Size the attribute table and the vendor specific UUID space to cover the
+  // core services plus each of the selected services.
+
+  unsigned                      space = BLUETOOTH_TABLE_CORE;
+  unsigned char                 uuids = BLUETOOTH_VSID_CORE;
+
+  if ( services & BLUETOOTH_SERVICE_SURFACE ) { space += BLUETOOTH_TABLE_SURFACE; uuids += BLUETOOTH_VSID_SERVICE; }
+  if ( services & BLUETOOTH_SERVICE_TELEMETRY ) { space += BLUETOOTH_TABLE_TELEMETRY; uuids += BLUETOOTH_VSID_SERVICE; }
+  if ( services & BLUETOOTH_SERVICE_ATMOSPHERE ) { space += BLUETOOTH_TABLE_ATMOSPHERE; uuids += BLUETOOTH_VSID_SERVICE; }
+  if ( services & BLUETOOTH_SERVICE_HANDLING ) { space += BLUETOOTH_TABLE_HANDLING; uuids += BLUETOOTH_VSID_SERVICE; }
 
   // Configure the BLE device settings and limits.
 
@@ -29,10 +40,10 @@ unsigned bluetooth_start ( const char * label ) {
   const softble_settings_t   settings = { .limits = { .servers  = BLUETOOTH_SERVER_LIMIT,
                                                       .clients  = BLUETOOTH_CLIENT_LIMIT,
                                                       .notices  = BLUETOOTH_QUEUE_SIZE,
-                                                      .uuids    = BLUETOOTH_VSID_COUNT,
+                                                      .uuids    = uuids,
                                                       .mtu      = BLUETOOTH_MTU_LENGTH },
                                           .event  = BLUETOOTH_EVENT_LENGTH,
-                                          .space  = BLUETOOTH_TABLE_SIZE };
+                                          .space  = space };
 
   // Request the BLE device and establish the default communication parameters.
 
@@ -42,3 +53,106 @@ unsigned bluetooth_start ( const char * label ) {
   return ( result );
 
   }
+
+//=============================================================================
+// SECTION : BLUETOOTH LOW ENERGY SCANNING
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+//  function: bluetooth_scan_begin ( duration, interval, report )
+// arguments: duration - scan duration in seconds
+//            interval - scan interval (and window) in seconds
+//            report - buffer to receive the advertising reports
+//   returns: NRF_SUCCESS - if the scan was started
+//            NRF_ERROR_INVALID_STATE - if a scan is already running
+//
+// Start a passive scan, which never requests scan responses. The scan window
+// covers the whole interval and the scan times out after the duration.
+//-----------------------------------------------------------------------------
+
+unsigned bluetooth_scan_begin ( float duration, float interval, ble_data_t * report ) {
+
+  ble_gap_scan_params_t        params = { .active = 0, .scan_phys = BLE_GAP_PHY_1MBPS,
+                                          .interval = (unsigned short) roundf ( interval / 625e-6 ),
+                                          .window = (unsigned short) roundf ( interval / 625e-6 ),
+                                          .timeout = (unsigned short) roundf ( duration * 100.0 ) };
+
+  return ( sd_ble_gap_scan_start ( &(params), report ) );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: bluetooth_scan_resume ( report )
+// arguments: report - buffer to receive the advertising reports
+//   returns: NRF_SUCCESS - if the scan was resumed
+//            NRF_ERROR_INVALID_STATE - if the scan is not paused
+//
+// Resume a scan paused by the delivery of an advertising report.
+//-----------------------------------------------------------------------------
+
+unsigned bluetooth_scan_resume ( ble_data_t * report ) { return ( sd_ble_gap_scan_start ( NULL, report ) ); }
+
+//-----------------------------------------------------------------------------
+//  function: bluetooth_scan_cease ( )
+//   returns: NRF_SUCCESS - if the scan was stopped
+//            NRF_ERROR_INVALID_STATE - if no scan is running
+//-----------------------------------------------------------------------------
+
+unsigned bluetooth_scan_cease ( void ) { return ( sd_ble_gap_scan_stop ( ) ); }
+
+//=============================================================================
+// SECTION : BLUETOOTH LOW ENERGY GATT SERVER
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+//  function: bluetooth_uuid_base ( identity, type )
+// arguments: identity - 128-bit UUID whose base is to be resolved
+//            type - variable to receive the vendor specific UUID type
+//   returns: NRF_SUCCESS - if resolved
+//            NRF_ERROR_NO_MEM - if the vendor specific UUID space is full
+//
+// Resolve the vendor specific UUID type of a 128-bit base. A base which the
+// stack already holds resolves to its existing type.
+//-----------------------------------------------------------------------------
+
+unsigned bluetooth_uuid_base ( const void * identity, unsigned char * type ) {
+
+  ble_uuid128_t                  base;
+
+  memcpy ( &(base), identity, sizeof(ble_uuid128_t) );
+
+  return ( sd_ble_uuid_vs_add ( &(base), type ) );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: bluetooth_characteristic ( service, meta, attribute, handles )
+// arguments: service - handle of the service to add the characteristic to
+//            meta - characteristic properties
+//            attribute - characteristic value attribute
+//            handles - structure to receive the characteristic handles
+//   returns: NRF_SUCCESS - if added
+//
+// Add a characteristic to the most recently added service.
+//-----------------------------------------------------------------------------
+
+unsigned bluetooth_characteristic ( unsigned short service, ble_gatts_char_md_t * meta, ble_gatts_attr_t * attribute, ble_gatts_char_handles_t * handles ) {
+
+  return ( sd_ble_gatts_characteristic_add ( service, meta, attribute, handles ) );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: bluetooth_authorize ( connection, reply )
+// arguments: connection - connection handle of the requesting peer
+//            reply - authorization reply
+//   returns: NRF_SUCCESS - if the reply was sent
+//
+// Reply to an authorized read or write request from a peer.
+//-----------------------------------------------------------------------------
+
+unsigned bluetooth_authorize ( unsigned short connection, ble_gatts_rw_authorize_reply_params_t * reply ) {
+
+  return ( sd_ble_gatts_rw_authorize_reply ( connection, reply ) );
+
+  }
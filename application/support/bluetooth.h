@@ -9,6 +9,8 @@
 // (c) Copyright 2016-2020 Velvetwire, LLC. All rights reserved.
 //=============================================================================
 
+#include  "shockvx.h"
+
 #ifndef   __BLUETOOTH__
 #define   __BLUETOOTH__
 
@@ -27,12 +29,32 @@
 // BLE stack configuration.
 //-----------------------------------------------------------------------------
 
-#define   BLUETOOTH_SERVER_LIMIT      1                                         // One peripheral server required
+#define   BLUETOOTH_SERVER_LIMIT      2                                         // Two concurrent peripheral links
 #define   BLUETOOTH_CLIENT_LIMIT      0                                         // No central clients required
 
 #define   BLUETOOTH_QUEUE_SIZE        BLE_GATTS_HVN_TX_QUEUE_SIZE_DEFAULT       // Use the default queue size
-#define   BLUETOOTH_TABLE_SIZE        (0x720)                                   // Use a larger table size to accomodate characteristics
-#define   BLUETOOTH_VSID_COUNT        BLE_UUID_VS_COUNT_DEFAULT                 // Use the default vendor specific ID space count
+
+//-----------------------------------------------------------------------------
+// GATT service selection. The attribute table and the vendor specific UUID
+// space are sized from the services selected when the stack is started, so
+// that smaller hardware variants return the unused space to the heap. The
+// core services (GAP, GATT, battery, information, access and control) are
+// always present.
+//-----------------------------------------------------------------------------
+
+#define   BLUETOOTH_SERVICE_SURFACE   (1 << 0)                                  // Surface temperature service
+#define   BLUETOOTH_SERVICE_TELEMETRY (1 << 1)                                  // Telemetry settings service
+#define   BLUETOOTH_SERVICE_ATMOSPHERE (1 << 2)                                 // Atmospheric telemetry service
+#define   BLUETOOTH_SERVICE_HANDLING  (1 << 3)                                  // Orientation and handling service
+
+#define   BLUETOOTH_TABLE_CORE        (0x400)                                   // Attribute table space for the core services
+#define   BLUETOOTH_TABLE_SURFACE     (0x0C0)                                   // Attribute table space for the surface service
+#define   BLUETOOTH_TABLE_TELEMETRY   (0x060)                                   // Attribute table space for the telemetry service
+#define   BLUETOOTH_TABLE_ATMOSPHERE  (0x0E0)                                   // Attribute table space for the atmosphere service
+#define   BLUETOOTH_TABLE_HANDLING    (0x180)                                   // Attribute table space for the handling service (stream batch)
+
+#define   BLUETOOTH_VSID_CORE         (2)                                       // Vendor specific UUID bases for the core services (access, control)
+#define   BLUETOOTH_VSID_SERVICE      (1)                                       // Vendor specific UUID base for each selected service
 
 //-----------------------------------------------------------------------------
 // BLE connection preferences
@@ -47,7 +69,26 @@
 // Bluetooth low energy device.
 //-----------------------------------------------------------------------------
 
-          unsigned                    bluetooth_start ( const char * label );
+          unsigned                    bluetooth_start ( const char * label, unsigned services );
+
+//-----------------------------------------------------------------------------
+// Passive scanning on the 1M PHY. The stack pauses the scan after each
+// advertising report it delivers, so the scan must be resumed, from thread
+// context, once the report has been handled.
+//-----------------------------------------------------------------------------
+
+          unsigned                    bluetooth_scan_begin ( float duration, float interval, ble_data_t * report );
+          unsigned                    bluetooth_scan_resume ( ble_data_t * report );
+          unsigned                    bluetooth_scan_cease ( void );
+
+//-----------------------------------------------------------------------------
+// GATT server primitives which the stack abstraction does not cover, used by
+// the table driven services.
+//-----------------------------------------------------------------------------
+
+          unsigned                    bluetooth_uuid_base ( const void * identity, unsigned char * type );
+          unsigned                    bluetooth_characteristic ( unsigned short service, ble_gatts_char_md_t * meta, ble_gatts_attr_t * attribute, ble_gatts_char_handles_t * handles );
+          unsigned                    bluetooth_authorize ( unsigned short connection, ble_gatts_rw_authorize_reply_params_t * reply );
 
 
 //=============================================================================
@@ -63,10 +104,13 @@
 typedef   enum {
 
           BEACON_TYPE_BLE_4,                                                    // Use BLE 4.x compliant beacon broadcast (31 byte data and 31 byte scan packets)
-          BEACON_TYPE_BLE_5,                                                    // Use BLE 5.x compliant beacon broadcast (255 byte scan packet)
+          BEACON_TYPE_BLE_5,                                                    // Use BLE 5.x compliant beacon broadcast (single extended packet of up to 255 bytes)
+          BEACON_TYPE_DUAL,                                                     // Alternate the BLE 4.x frames and the BLE 5.x packet on the advertising set
 
           } beacon_type_t;
 
+#define   BEACON_BROADCAST_TYPE       BEACON_TYPE_DUAL                          // Beacon broadcast type used by the application
+
           unsigned                    beacon_start ( unsigned short variant );
           unsigned                    beacon_state ( bool * active );
           unsigned                    beacon_close ( void );
@@ -82,6 +126,48 @@ typedef   enum {
 #define   BEACON_BROADCAST_POWER      (0)                                       // Broadcast at 0 db
 #define   BEACON_BROADCAST_PERIOD     ((float) 0)                               // Broadcast indefinitely
 
+//-----------------------------------------------------------------------------
+// Beacon cadence. The broadcast is quickened while the tag is moving or out
+// of compliance and slowed while it rests in compliance. When the battery is
+// critical, each cadence steps down a level.
+//-----------------------------------------------------------------------------
+
+#define   BEACON_CADENCE_ALERT_RATE   ((float) 4175e-4)                         // Broadcast at 417.5 ms when moving or non-compliant
+#define   BEACON_CADENCE_ALERT_POWER  (4)                                       //  at 4 dB
+#define   BEACON_CADENCE_QUIET_RATE   ((float) 4.0)                             // Broadcast every 4 seconds when resting in compliance
+#define   BEACON_CADENCE_QUIET_POWER  (-8)                                      //  at -8 dB
+#define   BEACON_CADENCE_SAVER_RATE   ((float) 10.0)                            // Broadcast every 10 seconds to save a critical battery
+#define   BEACON_CADENCE_SAVER_POWER  (-8)                                      //  at -8 dB
+
+//-----------------------------------------------------------------------------
+// Beacon density survey. Every survey period the beacon listens passively for
+// a short window and counts the advertisements of its neighbours. In a dense
+// room the broadcast interval is stretched to keep collisions bounded. The
+// period can be set at any time; the survey itself only runs while a beacon
+// broadcast is under way.
+//-----------------------------------------------------------------------------
+
+#define   BEACON_SURVEY_PERIOD        ((float) 60.0)                            // Survey the neighbourhood every minute (0 = off)
+
+          unsigned                    beacon_survey ( float period );
+
+//-----------------------------------------------------------------------------
+// Beacon incident burst. When a drop, stress or tilt incident is detected,
+// the broadcast is rebuilt with the incident flags and briefly advertised at
+// a fast rate, so that a passing gateway has a good chance of catching it,
+// before falling back to the cadence.
+//-----------------------------------------------------------------------------
+
+#define   BEACON_BURST_RATE           ((float) 100e-3)                          // Broadcast at 100 ms during an incident burst
+#define   BEACON_BURST_POWER          (4)                                       //  at 4 dB
+#define   BEACON_BURST_DURATION       ((float) 5.0)                             //  for 5 seconds
+
+//-----------------------------------------------------------------------------
+// Beginning a broadcast which is already running with the same type and
+// period only re-times it: the interval and power are reprogrammed, but the
+// advertisement packets are kept and not rebuilt.
+//-----------------------------------------------------------------------------
+
           unsigned                    beacon_begin ( float interval, float period, signed char power, beacon_type_t type );
           unsigned                    beacon_cease ( void );
 
@@ -98,11 +184,21 @@ typedef   enum {
 
           unsigned                    beacon_notice ( beacon_notice_t notice, CTL_EVENT_SET_t * set, CTL_EVENT_SET_t events );
 
+//-----------------------------------------------------------------------------
+// Beacon record updates made between begin and commit are folded into one
+// rebuild of the advertisement.
+//-----------------------------------------------------------------------------
+
+          unsigned                    beacon_update_begin ( void );
+          unsigned                    beacon_update_commit ( void );
+
 //-----------------------------------------------------------------------------
 // Beacon device information
 //-----------------------------------------------------------------------------
 
           unsigned                    beacon_network ( void * node );
+          unsigned                    beacon_location ( void * location );
+          unsigned                    beacon_schedule ( float interval );
           unsigned                    beacon_battery ( signed char battery );
 
 //-----------------------------------------------------------------------------
@@ -180,6 +276,7 @@ typedef   enum {
           const void *                control_uuid ( void );
           unsigned                    control_register ( void * node, void * lock, void * create, void * accept );
           unsigned                    control_tracking ( void * node, void * lock, void * create, void * accept );
+          unsigned                    control_database ( void );
 
 //-----------------------------------------------------------------------------
 // Control tracking window and status
@@ -204,10 +301,44 @@ typedef   unsigned short              control_status_t;
 #define   TELEMETRY_DEFAULT_INTERVAL  ((float) 15.0)                            // Collect telemetry every 15 seconds
 #define   TELEMETRY_SERVICE_INTERVAL  ((float) 2.5)                             // Every 2.5 seconds when connected
 
+#define   TELEMETRY_INTERVAL_MINIMUM  ((float) 1.0)                             // Shortest permitted measurement interval
+#define   TELEMETRY_INTERVAL_MAXIMUM  ((float) 60.0 * 60.0)                     // Longest permitted measurement interval
+#define   TELEMETRY_ARCHIVAL_MAXIMUM  ((float) 24.0 * 60.0 * 60.0)              // Longest permitted archive interval (0 = off)
 
           const void *                telemetry_uuid ( void );
           unsigned                    telemetry_register ( float interval, float archival );
           unsigned                    telemetry_settings ( float * interval, float * archival );
+          unsigned                    telemetry_configure ( float interval, float archival );
+
+typedef   enum {                                                                // Service notices:
+          TELEMETRY_NOTICE_CHANGED,                                             //  Intervals reconfigured by the peer
+          TELEMETRY_NOTICES
+          } telemetry_notice_t;
+
+          unsigned                    telemetry_notice ( telemetry_notice_t notice, CTL_EVENT_SET_t * set, CTL_EVENT_SET_t events );
+
+//-----------------------------------------------------------------------------
+// Measured channel GATT services. Each channel measures up to three values,
+// checks them against lower and upper limits, accumulates the time spent in
+// and out of compliance and archives quantized records. The surface and
+// atmosphere services below are channels of this engine.
+//-----------------------------------------------------------------------------
+
+#define   CHANNEL_FIELD_LIMIT         (3)                                       // Most values measured by one channel
+
+typedef   enum {                                                                // Measured channels:
+          CHANNEL_SURFACE,                                                      //  Surface temperature
+          CHANNEL_ATMOSPHERE,                                                   //  Atmospheric temperature, humidity and pressure
+          CHANNELS
+          } channel_type_t;
+
+          const void *                channel_uuid ( channel_type_t channel );
+          unsigned                    channel_register ( channel_type_t channel, const float * lower, const float * upper );
+          unsigned                    channel_settings ( channel_type_t channel, float * lower, float * upper );
+          unsigned                    channel_configure ( channel_type_t channel, const float * lower, const float * upper );
+          unsigned                    channel_measured ( channel_type_t channel, const float * values, float interval );
+          unsigned                    channel_compliance ( channel_type_t channel, float * incursion, float * excursion );
+          unsigned                    channel_archive ( channel_type_t channel );
 
 //-----------------------------------------------------------------------------
 // Surface temperature telemetry GATT service
@@ -215,6 +346,7 @@ typedef   unsigned short              control_status_t;
 
           unsigned                    surface_register ( float lower, float upper );
           unsigned                    surface_settings ( float * lower, float * upper );
+          unsigned                    surface_configure ( float lower, float upper );
           unsigned                    surface_measured ( float value, float interval );
 
 //-----------------------------------------------------------------------------
@@ -240,6 +372,7 @@ typedef   struct {
 
           unsigned                    atmosphere_register ( atmosphere_values_t * lower, atmosphere_values_t * upper );
           unsigned                    atmosphere_settings ( atmosphere_values_t * lower, atmosphere_values_t * upper );
+          unsigned                    atmosphere_configure ( atmosphere_values_t * lower, atmosphere_values_t * upper );
           unsigned                    atmosphere_measured ( atmosphere_values_t * values, float interval );
 
 //-----------------------------------------------------------------------------
@@ -273,7 +406,118 @@ typedef   struct {
           const void *                handling_uuid ( void );
           unsigned                    handling_register ( handling_values_t * limits );
           unsigned                    handling_settings ( handling_values_t * limits );
+          unsigned                    handling_configure ( handling_values_t * limits );
           unsigned                    handling_observed ( handling_values_t * values );
 
+//-----------------------------------------------------------------------------
+// Raw motion diagnostic stream. Samples are quantized to 16-bit integers by
+// the movement module and notified in batches, in the movement sample layout,
+// while a peer is subscribed.
+//-----------------------------------------------------------------------------
+
+#define   HANDLING_STREAM_BATCH       ((BLUETOOTH_MTU_LENGTH - 3 - 3) / sizeof(movement_sample_t))
+
+          unsigned                    handling_streaming ( unsigned * limit );
+          unsigned                    handling_stream ( movement_sample_t * samples, unsigned count );
+
+//-----------------------------------------------------------------------------
+// Handling service notices
+//-----------------------------------------------------------------------------
+
+typedef   enum {                                                                // Service notices:
+          HANDLING_NOTICE_STREAM,                                               //  Stream subscription changed
+          HANDLING_NOTICES
+          } handling_notice_t;
+
+          unsigned                    handling_notice ( handling_notice_t notice, CTL_EVENT_SET_t * set, CTL_EVENT_SET_t events );
+
+//-----------------------------------------------------------------------------
+// Bulk provisioning settings. The control service exposes the provisioning
+// subset of the application settings as a single versioned blob, terminated
+// by a CRC-16 (CCITT) of the preceding bytes. The lock always reads as zero;
+// writing a zero lock leaves the established lock unchanged.
+//-----------------------------------------------------------------------------
+
+#define   CONTROL_SETTINGS_VERSION    (0x01)                                    // Bulk settings layout version
+
+typedef   struct __attribute__ (( packed )) {                                   // Bulk settings:
+
+          unsigned char               version;                                  //  Layout version
+
+          hash_t                      node;                                     //  Tracking node (64-bit)
+          unsigned char               lock [ SOFTDEVICE_KEY_LENGTH ];           //  Security lock (128-bit, write only)
+
+          struct __attribute__ (( packed )) {                                   //  Surface limits:
+            float                     lower;                                    //   Lower surface limit
+            float                     upper;                                    //   Upper surface limit
+            } surface;
+
+          struct __attribute__ (( packed )) {                                   //  Atmospheric limits:
+            atmosphere_values_t       lower;                                    //   Lower telemetry limits
+            atmosphere_values_t       upper;                                    //   Upper telemetry limits
+            } atmosphere;
+
+          handling_values_t           handling;                                 //  Handling limits
+
+          struct __attribute__ (( packed )) {                                   //  Telemetry intervals:
+            float                     interval;                                 //   Measurement interval (seconds)
+            float                     archival;                                 //   Archive interval (seconds)
+            } telemetry;
+
+          unsigned short              checksum;                                 //  CRC-16 of the preceding bytes
+
+          } control_settings_t;
+
+          unsigned                    control_publish ( control_settings_t * settings );
+          unsigned                    control_provision ( control_settings_t * settings );
+
+//-----------------------------------------------------------------------------
+// Control commands and the combined on-demand measurement
+//-----------------------------------------------------------------------------
+
+#define   CONTROL_COMMAND_MEASURE     (0x01)                                    // Take an out of cycle measurement
+
+typedef   struct __attribute__ (( packed )) {                                   // Combined measurement:
+
+          unsigned                    time;                                     //  UTC time measured
+          float                       surface;                                  //  Surface temperature
+          atmosphere_values_t         atmosphere;                               //  Atmospheric values
+
+          } control_measurement_t;
+
+          unsigned                    control_measurement ( control_measurement_t * measurement );
+
+//-----------------------------------------------------------------------------
+// Location context. Gateways and readers which see the tag write the fixed
+// installation (campus, building, floor and zone) they belong to. The last
+// known location is kept in RAM and each change can be logged to the
+// location archive, which peers read back through the control service.
+//-----------------------------------------------------------------------------
+
+typedef   struct __attribute__ (( packed )) {                                   // Location context:
+
+          unsigned char               campus;                                   //  Campus
+          unsigned char               building;                                 //  Building
+          unsigned char               floor;                                    //  Floor
+          unsigned char               zone;                                     //  Zone
+
+          } control_location_t;
+
+          unsigned                    control_location ( control_location_t * location );
+          unsigned                    control_archive ( control_location_t * location );
+
+//-----------------------------------------------------------------------------
+// Control service notices
+//-----------------------------------------------------------------------------
+
+typedef   enum {                                                                // Service notices:
+          CONTROL_NOTICE_SETTINGS,                                              //  Bulk settings written by the peer
+          CONTROL_NOTICE_MEASURE,                                               //  Measurement requested by the peer
+          CONTROL_NOTICE_LOCATION,                                              //  Location written by the peer
+          CONTROL_NOTICES
+          } control_notice_t;
+
+          unsigned                    control_notice ( control_notice_t notice, CTL_EVENT_SET_t * set, CTL_EVENT_SET_t events );
+
 //=============================================================================
 #endif
@@ -18,43 +18,54 @@
 //=============================================================================
 
 //-----------------------------------------------------------------------------
+//  function: broadcast_packet ( buffer, code )
+// arguments: buffer - packet buffer
+//            code - packet code
+//   returns: the emptied packet (NULL if there is no buffer)
+//
+// Start a new packet with the given code in the buffer.
 //-----------------------------------------------------------------------------
 
-broadcast_packet_t * broadcast_packet ( unsigned short code ) {
-  
-  broadcast_packet_t *         packet = malloc ( sizeof(broadcast_packet_t ) );
-  
-  if ( packet ) { memset ( packet->data, 0, BROADCAST_PACKET_SIZE ); packet->code = code; }
+broadcast_packet_t * broadcast_packet ( broadcast_buffer_t * buffer, unsigned short code ) {
+
+  if ( buffer ) { buffer->length = 0; buffer->packet.code = code; }
+  else return ( NULL );
 
-  return ( packet );
+  return ( &(buffer->packet) );
 
   }
 
 //-----------------------------------------------------------------------------
+//  function: broadcast_length ( buffer )
+// arguments: buffer - packet buffer
+//   returns: the length of the record data in bytes
 //-----------------------------------------------------------------------------
 
-unsigned char broadcast_length ( broadcast_packet_t * packet ) {
+unsigned char broadcast_length ( broadcast_buffer_t * buffer ) { return ( buffer ? buffer->length : 0 ); }
 
-  unsigned char                length = 0;
+//-----------------------------------------------------------------------------
+//  function: broadcast_append ( buffer, data, size, type )
+// arguments: buffer - packet buffer
+//            data - record data
+//            size - size of the record data in bytes
+//            type - record type code
+//
+// Append a record to the packet. A record which does not fit is dropped.
+//-----------------------------------------------------------------------------
 
-  if ( packet ) for ( broadcast_record_t * record = (broadcast_record_t *) packet->data; record->size; record = (broadcast_record_t *) (packet->data + (++ length)) ) { length += record->size; }
+void broadcast_append ( broadcast_buffer_t * buffer, void * data, unsigned char size, unsigned char type ) {
 
-  return ( length );
+  if ( buffer && ((buffer->length + size + sizeof(broadcast_record_t)) <= BROADCAST_PACKET_SIZE) ) {
 
-  }
+    broadcast_record_t *       record = (broadcast_record_t *) (buffer->packet.data + buffer->length);
 
-//-----------------------------------------------------------------------------
-//-----------------------------------------------------------------------------
+    memcpy ( record + 1, data, size );
 
-void broadcast_append ( broadcast_packet_t * packet, void * data, unsigned char size, unsigned char type ) {
-  
-  unsigned char                length = broadcast_length ( packet );
-  broadcast_record_t *         record = (broadcast_record_t *) (packet->data + length);
+    record->size                      = size + 1;
+    record->type                      = type;
 
-  if ( packet && ((length + size + sizeof(short)) <= BROADCAST_PACKET_SIZE) ) { memcpy ( record + 1, data, size ); }
-  else return;
+    buffer->length                    = buffer->length + size + sizeof(broadcast_record_t);
 
-  record->size                        = size + 1;
-  record->type                        = type;
+    }
 
   }
\ No newline at end of file
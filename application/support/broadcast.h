@@ -39,9 +39,22 @@ typedef   struct __attribute__ (( packed )) {
 
           } broadcast_packet_t;
 
-          broadcast_packet_t *        broadcast_packet ( unsigned short code );
-          unsigned char               broadcast_length ( broadcast_packet_t * packet );
-          void                        broadcast_append ( broadcast_packet_t * packet, void * data, unsigned char size, unsigned char type );
+//-----------------------------------------------------------------------------
+// Packets are assembled in caller owned buffers which track the length of the
+// records appended so far, so that appending never has to walk the records
+// already in place and no heap memory is needed.
+//-----------------------------------------------------------------------------
+
+typedef   struct {                                                              // Broadcast packet buffer:
+
+          unsigned char               length;                                   //  Record data length in bytes
+          broadcast_packet_t          packet;                                   //  Packet under construction
+
+          } broadcast_buffer_t;
+
+          broadcast_packet_t *        broadcast_packet ( broadcast_buffer_t * buffer, unsigned short code );
+          unsigned char               broadcast_length ( broadcast_buffer_t * buffer );
+          void                        broadcast_append ( broadcast_buffer_t * buffer, void * data, unsigned char size, unsigned char type );
 
 //-----------------------------------------------------------------------------
 // Each manufacturer record starts with two bytes indicating size in bytes and
@@ -97,6 +110,15 @@ typedef   struct __attribute__ (( packed )) {
 
 //-----------------------------------------------------------------------------
 // The broadcast network notifies observers of the sub-network of the device.
+// When present, it is always the first record of the packet that carries it,
+// so that an observer can reject a foreign packet with a compare at a fixed
+// offset, before any secure identity verification.
+//
+// Only the extended packet carries the network alongside the other records.
+// A BLE 4.x rotation carries it in a frame of its own (there is no room for
+// it in the other frames or the scan response), so a legacy gateway must
+// match the other frames to the network frame by advertiser address before
+// it can reject them.
 //-----------------------------------------------------------------------------
 
 #define   BROADCAST_TYPE_NETWORK      0x03                                      // Network code
@@ -131,6 +153,52 @@ typedef   struct __attribute__ (( packed )) {
 
           } broadcast_variant_t;
 
+//-----------------------------------------------------------------------------
+// A broadcast which is too large for one packet is sent as a rotation of
+// frames. The frame record gives the index of the frame and the number of
+// frames in the rotation, so that a passive observer can tell when it has
+// collected them all.
+//-----------------------------------------------------------------------------
+
+#define   BROADCAST_TYPE_FRAME        0x09
+
+typedef   struct __attribute__ (( packed )) {                                   // Broadcast frame record:
+
+          unsigned char               frame;                                    //  Frame index (high nibble) and count (low nibble)
+
+          } broadcast_frame_t;
+
+#define   BROADCAST_FRAME(i,n)        ((unsigned char) (((i) << 4) | ((n) & 15)))
+
+//-----------------------------------------------------------------------------
+// The broadcast sequence is bumped only when one of the telemetry records has
+// changed value. It leads the telemetry records, so an observer can drop a
+// repeated packet without parsing the records which follow.
+//-----------------------------------------------------------------------------
+
+#define   BROADCAST_TYPE_SEQUENCE     0x0D
+
+typedef   struct __attribute__ (( packed )) {                                   // Broadcast sequence record:
+
+          unsigned char               change;                                   //  Change sequence (wraps)
+
+          } broadcast_sequence_t;
+
+//-----------------------------------------------------------------------------
+// The broadcast schedule tells observers when the telemetry records will next
+// carry a fresh sample, so that a gateway can sleep between samples and only
+// scan around the announced instants.
+//-----------------------------------------------------------------------------
+
+#define   BROADCAST_TYPE_SCHEDULE     0x0B
+
+typedef   struct __attribute__ (( packed )) {                                   // Broadcast schedule record:
+
+          unsigned short              interval;                                 //  Telemetry sample interval (in seconds)
+          unsigned                    next;                                     //  UTC time of the next fresh sample
+
+          } broadcast_schedule_t;
+
 
 //=============================================================================
 // SECTION : BROADCAST POSITION ENCODINGS
@@ -0,0 +1,530 @@
+//=============================================================================
+// project: ShockVx
+//  module: Stickershock firmware for cold chain tracking.
+//  author: Velvetwire, llc
+//    file: gatt.c
+//
+// Table driven GATT service declaration and write dispatch.
+//
+// (c) Copyright 2016-2020 Velvetwire, LLC. All rights reserved.
+//=============================================================================
+
+#include  <stickershock.h>
+
+#include  "bluetooth.h"
+#include  "gatt.h"
+
+//=============================================================================
+// SECTION : GATT SERVICE TABLES
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+// Running signature of the declared database layout, and the fixed key used
+// to derive it.
+//-----------------------------------------------------------------------------
+
+static    hash_t                      signature = 0;
+static    const unsigned char         signing [ SOFTDEVICE_KEY_LENGTH ] = { 0 };
+
+//-----------------------------------------------------------------------------
+//  function: gatt_register ( gatt, mutex, identity, table, count, context, subscribe )
+// arguments: gatt - service table resource
+//            mutex - service access mutex
+//            identity - 128-bit service UUID
+//            table - characteristic descriptors
+//            count - number of descriptors
+//            context - context passed to the write and subscription hooks
+//            subscribe - subscription hook (optional)
+//   returns: NRF_ERROR_RESOURCES - if no resources available
+//            NRF_ERROR_DATA_SIZE - if the service spans too many handles
+//            NRF_SUCCESS - if registered
+//
+// Register a primary service with the Bluetooth stack, declare each of the
+// characteristics in the table and build the handle index.
+//-----------------------------------------------------------------------------
+
+unsigned gatt_register ( gatt_service_t * gatt, CTL_MUTEX_t * mutex, const void * identity, gatt_characteristic_t * table, unsigned char count, void * context, gatt_subscribe_t subscribe ) {
+
+  unsigned                     result = NRF_SUCCESS;
+  static uuid_t                    id;
+
+  // Register the service with the soft device low energy stack and fold the
+  // service UUID and handle into the layout signature.
+
+  if ( (gatt->service = softble_server_register ( BLE_GATTS_SRVC_TYPE_PRIMARY, identity )) ) {
+
+    unsigned char          record [ sizeof(hash_t) + sizeof(uuid_t) + sizeof(short) ];
+
+    memcpy ( record, &(signature), sizeof(hash_t) );
+    memcpy ( record + sizeof(hash_t), identity, sizeof(uuid_t) );
+    memcpy ( record + sizeof(hash_t) + sizeof(uuid_t), &(gatt->service), sizeof(short) );
+
+    signature                         = hash ( signing, record, sizeof(record) );
+
+    gatt->mutex                       = mutex;
+    gatt->table                       = table;
+    gatt->count                       = count;
+    gatt->context                     = context;
+    gatt->subscribe                   = subscribe;
+    gatt->links                       = 0;
+    gatt->turn                        = 0;
+    gatt->dirty                       = 0;
+
+    for ( unsigned char n = 0; n < GATT_LINK_LIMIT; ++ n ) { gatt->link[ n ].connection = BLE_CONN_HANDLE_INVALID; }
+
+    memset ( gatt->index, 0, GATT_HANDLE_SPAN );
+
+    } else return ( NRF_ERROR_RESOURCES );
+
+  // Declare each characteristic and index its value and CCCD handles.
+
+  for ( unsigned char n = 0; (NRF_SUCCESS == result) && (n < count); ++ n ) {
+
+    gatt_characteristic_t * characteristic = table + n;
+    softble_characteristic_t     data = { .handles  = characteristic->handles,
+                                          .length   = characteristic->length,
+                                          .limit    = characteristic->limit,
+                                          .value    = characteristic->value };
+
+    if ( ! characteristic->attributes ) continue;
+
+    if ( characteristic->options & GATT_OPTION_RESIDENT ) { result = gatt_declare ( gatt, characteristic, uuid ( &(id), characteristic->uuid ) ); }
+    else { result = softble_characteristic_declare ( gatt->service, characteristic->attributes, uuid ( &(id), characteristic->uuid ), &(data) ); }
+
+    if ( NRF_SUCCESS != result ) break;
+
+    unsigned short              value = characteristic->handles->value_handle - gatt->service;
+    unsigned short               cccd = characteristic->handles->cccd_handle - gatt->service;
+
+    if ( value < GATT_HANDLE_SPAN ) { gatt->index[ value ] = n + 1; }
+    else { result = NRF_ERROR_DATA_SIZE; }
+
+    if ( characteristic->handles->cccd_handle != BLE_GATT_HANDLE_INVALID ) {
+
+      if ( cccd < GATT_HANDLE_SPAN ) { gatt->index[ cccd ] = (n + 1) | GATT_INDEX_CCCD; }
+      else { result = NRF_ERROR_DATA_SIZE; }
+
+      }
+
+    // Fold the declaration into the layout signature.
+
+    gatt_layout_t              layout = { .signature  = signature,
+                                          .service    = gatt->service,
+                                          .uuid       = characteristic->uuid,
+                                          .attributes = characteristic->attributes,
+                                          .value      = characteristic->handles->value_handle,
+                                          .cccd       = characteristic->handles->cccd_handle };
+
+    signature                         = hash ( signing, &(layout), sizeof(gatt_layout_t) );
+
+    }
+
+  // Return with registration result.
+
+  return ( result );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: gatt_signature ( )
+// arguments: none
+//   returns: signature of the database layout declared so far
+//-----------------------------------------------------------------------------
+
+hash_t gatt_signature ( void ) { return ( signature ); }
+
+//-----------------------------------------------------------------------------
+//  function: gatt_declare ( gatt, characteristic, identity )
+// arguments: gatt - service table resource
+//            characteristic - characteristic descriptor
+//            identity - 128-bit characteristic UUID
+//   returns: NRF_ERROR_NOT_SUPPORTED - if the characteristic is writable
+//            NRF_SUCCESS - if declared
+//
+// Declare a resident characteristic whose value stays in the service memory.
+// The UUID shares the vendor specific base of its service, which the stack
+// already holds, so no additional UUID space is used.
+//-----------------------------------------------------------------------------
+
+unsigned gatt_declare ( gatt_service_t * gatt, gatt_characteristic_t * characteristic, const void * identity ) {
+
+  ble_uuid_t                     type = { .uuid = (unsigned short) (characteristic->uuid & 0xFFFF) };
+  ble_gatts_char_md_t            meta = { 0 };
+  ble_gatts_attr_md_t            cccd = { .vloc = BLE_GATTS_VLOC_STACK };
+  ble_gatts_attr_md_t            data = { .vloc = BLE_GATTS_VLOC_USER };
+  ble_gatts_attr_t          attribute = { .p_uuid = &(type), .p_attr_md = &(data),
+                                          .init_len = characteristic->length,
+                                          .max_len = characteristic->limit,
+                                          .p_value = (unsigned char *) characteristic->value };
+  unsigned                     result = NRF_SUCCESS;
+
+  // The stack cannot write into a resident value on behalf of a peer.
+
+  if ( characteristic->attributes & BLE_ATTR_WRITE ) return ( NRF_ERROR_NOT_SUPPORTED );
+
+  // Resolve the vendor specific UUID type from the 128-bit base.
+
+  if ( NRF_SUCCESS != (result = bluetooth_uuid_base ( identity, &(type.type) )) ) return ( result );
+
+  // Describe the characteristic properties and the value permissions.
+
+  meta.char_props.read                = (characteristic->attributes & BLE_ATTR_READ) ? 1 : 0;
+  meta.char_props.notify              = (characteristic->attributes & BLE_ATTR_NOTIFY) ? 1 : 0;
+  meta.p_cccd_md                      = meta.char_props.notify ? &(cccd) : NULL;
+
+  BLE_GAP_CONN_SEC_MODE_SET_OPEN ( &(cccd.read_perm) );
+  BLE_GAP_CONN_SEC_MODE_SET_OPEN ( &(cccd.write_perm) );
+
+  if ( characteristic->attributes & BLE_ATTR_PROTECTED ) { BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM ( &(data.read_perm) ); }
+  else { BLE_GAP_CONN_SEC_MODE_SET_OPEN ( &(data.read_perm) ); }
+
+  BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS ( &(data.write_perm) );
+
+  data.vlen                           = (characteristic->attributes & BLE_ATTR_VARIABLE) ? 1 : 0;
+
+  // Add the characteristic to the service.
+
+  return ( bluetooth_characteristic ( gatt->service, &(meta), &(attribute), characteristic->handles ) );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: gatt_event ( gatt, event )
+// arguments: gatt - service table resource
+//            event - BLE event structure
+//   returns: NRF_SUCCESS if event processed
+//
+// Process the GATT server events common to all table driven services: value
+// and CCCD writes, transmit queue completion and MTU exchange.
+//-----------------------------------------------------------------------------
+
+unsigned gatt_event ( gatt_service_t * gatt, ble_evt_t * event ) {
+
+  unsigned short           connection = event->evt.gatts_evt.conn_handle;
+  gatt_link_t *                  link = NULL;
+
+  switch ( event->header.evt_id ) {
+
+    case BLE_GATTS_EVT_WRITE:     return gatt_write ( gatt, connection, &(event->evt.gatts_evt.params.write) );
+    case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+                                  return gatt_complete ( gatt, connection );
+
+    case BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST:
+
+      ctl_mutex_lock_uc ( gatt->mutex );
+
+      if ( (link = gatt_link ( gatt, connection )) ) {
+        link->mtu                     = event->evt.gatts_evt.params.exchange_mtu_request.client_rx_mtu;
+        link->mtu                     = (link->mtu < BLUETOOTH_MTU_LENGTH) ? link->mtu : BLUETOOTH_MTU_LENGTH;
+        }
+
+      return ( ctl_mutex_unlock ( gatt->mutex ), NRF_SUCCESS );
+
+    default:                      return ( NRF_SUCCESS );
+
+    }
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: gatt_write ( gatt, connection, write )
+// arguments: gatt - service table resource
+//            connection - connection handle
+//            write - write information structure
+//   returns: NRF_SUCCESS - if processed (or not for this service)
+//            NRF_ERROR_INVALID_LENGTH - if the write exceeds the value storage
+//
+// Dispatch a write event to the service. CCCD writes update the subscription
+// flags of the writing link. Value writes are checked against the value
+// storage, copied when the value is protected and passed to the apply hook.
+//-----------------------------------------------------------------------------
+
+unsigned gatt_write ( gatt_service_t * gatt, unsigned short connection, ble_gatts_evt_write_t * write ) {
+
+  unsigned short               offset = write->handle - gatt->service;
+  unsigned char                 entry = (offset < GATT_HANDLE_SPAN) ? gatt->index[ offset ] : 0;
+  unsigned                     result = NRF_SUCCESS;
+
+  // Ignore handles that do not belong to this service.
+
+  if ( entry ) { ctl_mutex_lock_uc ( gatt->mutex ); }
+  else return ( NRF_SUCCESS );
+
+  gatt_characteristic_t * characteristic = gatt->table + ((entry & ~(GATT_INDEX_CCCD)) - 1);
+  gatt_link_t *                  link = gatt_link ( gatt, connection );
+
+  // Track the notification subscriptions of the peer.
+
+  if ( entry & GATT_INDEX_CCCD ) {
+
+    if ( link && (write->len >= sizeof(short)) ) {
+
+      if ( write->data[ 0 ] & BLE_GATT_HVX_NOTIFICATION ) { link->subscribed |= characteristic->link; }
+      else { link->subscribed &= ~(characteristic->link); link->pending &= ~(characteristic->link); }
+
+      if ( gatt->subscribe ) { gatt->subscribe ( gatt->context, connection, characteristic->link ); }
+
+      // Bring a newly subscribed peer up to date with a resident value that
+      // changed while nobody was subscribed.
+
+      if ( (link->subscribed & gatt->dirty & characteristic->link) ) {
+        gatt->dirty                  &= ~(characteristic->link);
+        gatt_notify ( gatt, characteristic->link, connection );
+        }
+
+      }
+
+    }
+
+  // Make sure that the write falls within the value storage. For protected
+  // characteristics, the write data needs to be transferred directly to the
+  // value data.
+
+  else if ( (write->offset <= characteristic->limit) && (write->len <= (characteristic->limit - write->offset)) ) {
+
+    if ( characteristic->attributes & BLE_ATTR_PROTECTED ) { memcpy ( (unsigned char *) characteristic->value + write->offset, write->data, write->len ); }
+    if ( characteristic->apply ) { characteristic->apply ( gatt->context, connection, write ); }
+
+    } else { result = NRF_ERROR_INVALID_LENGTH; }
+
+  // Write processed.
+
+  return ( ctl_mutex_unlock ( gatt->mutex ), result );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: gatt_lookup ( gatt, handle )
+// arguments: gatt - service table resource
+//            handle - attribute value handle
+//   returns: characteristic descriptor or NULL if not part of the service
+//
+// Find the characteristic descriptor for an attribute value handle.
+//-----------------------------------------------------------------------------
+
+gatt_characteristic_t * gatt_lookup ( gatt_service_t * gatt, unsigned short handle ) {
+
+  unsigned short               offset = handle - gatt->service;
+  unsigned char                 entry = (offset < GATT_HANDLE_SPAN) ? gatt->index[ offset ] : 0;
+
+  if ( entry && !(entry & GATT_INDEX_CCCD) ) { return ( gatt->table + (entry - 1) ); }
+  else return ( NULL );
+
+  }
+
+
+//=============================================================================
+// SECTION : GATT PEER LINKS
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+//  function: gatt_attach ( gatt, connection )
+// arguments: gatt - service table resource
+//            connection - connection handle
+//   returns: NRF_SUCCESS - if attached
+//            NRF_ERROR_NO_MEM - if all links are in use
+//
+// Attach a newly connected peer with a default profile and no subscriptions.
+// The caller holds the service mutex.
+//-----------------------------------------------------------------------------
+
+unsigned gatt_attach ( gatt_service_t * gatt, unsigned short connection ) {
+
+  gatt_link_t *                  link = gatt_link ( gatt, BLE_CONN_HANDLE_INVALID );
+
+  if ( link ) { ++ gatt->links; }
+  else return ( NRF_ERROR_NO_MEM );
+
+  link->connection                    = connection;
+  link->mtu                           = BLE_GATT_ATT_MTU_DEFAULT;
+  link->subscribed                    = 0;
+  link->pending                       = 0;
+
+  return ( NRF_SUCCESS );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: gatt_detach ( gatt, connection )
+// arguments: gatt - service table resource
+//            connection - connection handle
+//   returns: subscriptions held by the link at the time it was dropped
+//
+// Release the link of a disconnected peer. The caller holds the service mutex.
+//-----------------------------------------------------------------------------
+
+unsigned char gatt_detach ( gatt_service_t * gatt, unsigned short connection ) {
+
+  gatt_link_t *                  link = gatt_link ( gatt, connection );
+  unsigned char            subscribed = 0;
+
+  if ( link && (connection != BLE_CONN_HANDLE_INVALID) ) {
+
+    subscribed                        = link->subscribed;
+
+    link->connection                  = BLE_CONN_HANDLE_INVALID;
+    link->subscribed                  = 0;
+    link->pending                     = 0;
+
+    -- gatt->links;
+
+    }
+
+  return ( subscribed );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: gatt_link ( gatt, connection )
+// arguments: gatt - service table resource
+//            connection - connection handle (invalid to find a free link)
+//   returns: link or NULL if the connection is not linked
+//-----------------------------------------------------------------------------
+
+gatt_link_t * gatt_link ( gatt_service_t * gatt, unsigned short connection ) {
+
+  for ( unsigned char n = 0; n < GATT_LINK_LIMIT; ++ n ) { if ( gatt->link[ n ].connection == connection ) return ( gatt->link + n ); }
+
+  return ( NULL );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: gatt_subscribed ( gatt, link )
+// arguments: gatt - service table resource
+//            link - characteristic link bit
+//   returns: number of linked peers subscribed to the characteristic
+//-----------------------------------------------------------------------------
+
+unsigned char gatt_subscribed ( gatt_service_t * gatt, unsigned char link ) {
+
+  unsigned char                 count = 0;
+
+  for ( unsigned char n = 0; n < GATT_LINK_LIMIT; ++ n ) {
+    if ( (gatt->link[ n ].connection != BLE_CONN_HANDLE_INVALID) && (gatt->link[ n ].subscribed & link) ) { ++ count; }
+    }
+
+  return ( count );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: gatt_mtu ( gatt, link )
+// arguments: gatt - service table resource
+//            link - characteristic link bit
+//   returns: smallest ATT MTU of the peers subscribed to the characteristic,
+//            or zero if there are none
+//
+// A value notified to every subscriber has to fit the smallest of their MTUs.
+//-----------------------------------------------------------------------------
+
+unsigned short gatt_mtu ( gatt_service_t * gatt, unsigned char link ) {
+
+  unsigned short                  mtu = 0;
+
+  for ( unsigned char n = 0; n < GATT_LINK_LIMIT; ++ n ) {
+
+    if ( (gatt->link[ n ].connection == BLE_CONN_HANDLE_INVALID) || !(gatt->link[ n ].subscribed & link) ) continue;
+    if ( (mtu == 0) || (gatt->link[ n ].mtu < mtu) ) { mtu = gatt->link[ n ].mtu; }
+
+    }
+
+  return ( mtu );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: gatt_notify ( gatt, link, connection )
+// arguments: gatt - service table resource
+//            link - characteristic link bit
+//            connection - connection handle (BLE_CONN_HANDLE_ALL for every peer)
+//   returns: NRF_SUCCESS - if queued or held for at least one peer
+//            NRF_ERROR_INVALID_STATE - if no peer is subscribed
+//            NRF_ERROR_NOT_FOUND - if no characteristic has the link bit
+//
+// Notify the current characteristic value to the subscribed peers. The peers
+// are served in turn, starting one link further on at each call. A peer with
+// a full transmit queue has the notification held as pending; the value is
+// sent once its queue drains, by which time it may have been replaced with a
+// newer one. The caller holds the service mutex.
+//-----------------------------------------------------------------------------
+
+unsigned gatt_notify ( gatt_service_t * gatt, unsigned char link, unsigned short connection ) {
+
+  unsigned short               handle = BLE_GATT_HANDLE_INVALID;
+  unsigned                     result = NRF_ERROR_INVALID_STATE;
+
+  // Find the value handle of the characteristic.
+
+  for ( unsigned char n = 0; n < gatt->count; ++ n ) {
+    if ( (gatt->table[ n ].link == link) && gatt->table[ n ].attributes ) { handle = gatt->table[ n ].handles->value_handle; break; }
+    }
+
+  if ( handle == BLE_GATT_HANDLE_INVALID ) return ( NRF_ERROR_NOT_FOUND );
+
+  // Serve each subscribed peer, starting with the one whose turn it is.
+
+  for ( unsigned char n = 0; n < GATT_LINK_LIMIT; ++ n ) {
+
+    gatt_link_t *                peer = gatt->link + ((gatt->turn + n) % GATT_LINK_LIMIT);
+
+    if ( (peer->connection == BLE_CONN_HANDLE_INVALID) || !(peer->subscribed & link) ) continue;
+    if ( (connection != BLE_CONN_HANDLE_ALL) && (connection != peer->connection) ) continue;
+
+    if ( NRF_ERROR_RESOURCES == softble_characteristic_notify ( handle, peer->connection ) ) { peer->pending |= link; }
+    else { peer->pending &= ~(link); }
+
+    result                            = NRF_SUCCESS;
+
+    }
+
+  gatt->turn                          = (gatt->turn + 1) % GATT_LINK_LIMIT;
+
+  return ( result );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: gatt_mark ( gatt, link )
+// arguments: gatt - service table resource
+//            link - characteristic link bit
+//   returns: NRF_SUCCESS - if notified or marked
+//
+// A resident value has changed. Peers read it directly from the service, so
+// the stack is only involved when a subscribed peer needs a notification.
+// Without a subscriber, the value is marked dirty instead. The caller holds
+// the service mutex.
+//-----------------------------------------------------------------------------
+
+unsigned gatt_mark ( gatt_service_t * gatt, unsigned char link ) {
+
+  if ( gatt_subscribed ( gatt, link ) ) { gatt->dirty &= ~(link); }
+  else { gatt->dirty |= link; return ( NRF_SUCCESS ); }
+
+  return ( gatt_notify ( gatt, link, BLE_CONN_HANDLE_ALL ) );
+
+  }
+
+//-----------------------------------------------------------------------------
+//  function: gatt_complete ( gatt, connection )
+// arguments: gatt - service table resource
+//            connection - connection handle
+//   returns: NRF_SUCCESS
+//
+// The transmit queue of a peer has drained. Re-issue the notifications held
+// for that peer.
+//-----------------------------------------------------------------------------
+
+unsigned gatt_complete ( gatt_service_t * gatt, unsigned short connection ) {
+
+  ctl_mutex_lock_uc ( gatt->mutex );
+
+  gatt_link_t *                  link = gatt_link ( gatt, connection );
+
+  if ( link && link->pending ) for ( unsigned char bit = 1; bit; bit <<= 1 ) {
+    if ( link->pending & bit ) { gatt_notify ( gatt, bit, connection ); }
+    }
+
+  return ( ctl_mutex_unlock ( gatt->mutex ), NRF_SUCCESS );
+
+  }
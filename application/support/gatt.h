@@ -0,0 +1,146 @@
+//=============================================================================
+// project: ShockVx
+//  module: Stickershock firmware for cold chain tracking.
+//  author: Velvetwire, llc
+//    file: gatt.h
+//
+// Table driven GATT service declaration and write dispatch.
+//
+// (c) Copyright 2016-2020 Velvetwire, LLC. All rights reserved.
+//=============================================================================
+
+#ifndef   __GATT__
+#define   __GATT__
+
+//=============================================================================
+// SECTION : GATT SERVICE TABLES
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+// Each characteristic of a service is described by a table entry giving its
+// UUID component, attributes, value storage and size. An entry with no
+// attributes is left out of the service. Writes to protected values are
+// bounds checked and copied into the value storage before the optional apply
+// hook is called. The link bit identifies the characteristic in the service
+// subscription flags.
+//
+// A resident value is declared with its value in the service memory rather
+// than in the stack attribute table (BLE_GATTS_VLOC_USER). Reads and
+// notifications take the value straight from the service, so it never has
+// to be copied into the stack. Resident values are read and notify only.
+//-----------------------------------------------------------------------------
+
+#define   GATT_OPTION_RESIDENT        (1 << 0)                                  // Value resides in service memory
+
+typedef   void                     (* gatt_apply_t) ( void * context, unsigned short connection, ble_gatts_evt_write_t * write );
+typedef   void                     (* gatt_subscribe_t) ( void * context, unsigned short connection, unsigned char link );
+
+typedef   struct {                                                              // Characteristic descriptor:
+
+          unsigned                    uuid;                                     //  32-bit characteristic UUID component
+          unsigned char               attributes;                               //  Characteristic attributes (0 = omit)
+          unsigned char               link;                                     //  Subscription link bit
+          unsigned char               options;                                  //  Declaration options
+
+          unsigned short              length;                                   //  Initial value length
+          unsigned short              limit;                                    //  Value storage size
+
+          void *                      value;                                    //  Value storage
+          ble_gatts_char_handles_t *  handles;                                  //  Characteristic handles
+          gatt_apply_t                apply;                                    //  Write hook (optional)
+
+          } gatt_characteristic_t;
+
+//-----------------------------------------------------------------------------
+// Each linked peer has its own connection profile, notification subscriptions
+// and notifications still waiting for room in its transmit queue.
+//-----------------------------------------------------------------------------
+
+#define   GATT_LINK_LIMIT             BLUETOOTH_SERVER_LIMIT                    // Concurrent peer links per service
+
+typedef   struct {                                                              // Peer link:
+
+          unsigned short              connection;                               //  Connection handle (invalid if free)
+          unsigned short              mtu;                                      //  Exchanged ATT MTU
+          unsigned char               subscribed;                               //  Notification subscriptions
+          unsigned char               pending;                                  //  Notifications awaiting queue space
+
+          } gatt_link_t;
+
+//-----------------------------------------------------------------------------
+// A service keeps a direct index from attribute handle (relative to the
+// service handle) to characteristic entry so that writes are dispatched
+// without searching. Notifications are issued to the linked peers in turn so
+// that no one link is always served first.
+//-----------------------------------------------------------------------------
+
+#define   GATT_HANDLE_SPAN            (32)                                      // Attribute handles indexed per service
+#define   GATT_INDEX_CCCD             (1 << 7)                                  // Index refers to the CCCD
+
+typedef   struct {                                                              // Service table:
+
+          unsigned short              service;                                  //  Service handle
+          unsigned char               count;                                    //  Number of characteristics
+          unsigned char               links;                                    //  Number of linked peers
+          unsigned char               turn;                                     //  Link served first by the next notify
+          unsigned char               dirty;                                    //  Resident values changed since last notified
+
+          CTL_MUTEX_t *               mutex;                                    //  Service access mutex
+          gatt_characteristic_t *     table;                                    //  Characteristic descriptors
+          void *                      context;                                  //  Hook context
+          gatt_subscribe_t            subscribe;                                //  Subscription hook (optional)
+
+          gatt_link_t                 link [ GATT_LINK_LIMIT ];                 //  Peer links
+          unsigned char               index [ GATT_HANDLE_SPAN ];               //  Handle to descriptor index
+
+          } gatt_service_t;
+
+          unsigned                    gatt_register ( gatt_service_t * gatt, CTL_MUTEX_t * mutex, const void * identity, gatt_characteristic_t * table, unsigned char count, void * context, gatt_subscribe_t subscribe );
+          unsigned                    gatt_declare ( gatt_service_t * gatt, gatt_characteristic_t * characteristic, const void * identity );
+          unsigned                    gatt_event ( gatt_service_t * gatt, ble_evt_t * event );
+          unsigned                    gatt_write ( gatt_service_t * gatt, unsigned short connection, ble_gatts_evt_write_t * write );
+
+          gatt_characteristic_t *     gatt_lookup ( gatt_service_t * gatt, unsigned short handle );
+
+//-----------------------------------------------------------------------------
+// Every declaration made through the service tables is folded into a layout
+// signature: the service UUID and handle, and the UUID, attributes and
+// handles of each characteristic. Two devices (or two boots) with the same
+// signature present the same attribute handles, so a central can use it to
+// validate a cached handle table instead of repeating service discovery.
+//-----------------------------------------------------------------------------
+
+typedef   struct __attribute__ (( packed )) {                                   // Layout record:
+
+          hash_t                      signature;                                //  Signature so far
+          unsigned short              service;                                  //  Service handle
+          unsigned                    uuid;                                     //  32-bit characteristic UUID component
+          unsigned char               attributes;                               //  Characteristic attributes
+          unsigned short              value;                                    //  Value handle
+          unsigned short              cccd;                                     //  CCCD handle
+
+          } gatt_layout_t;
+
+          hash_t                      gatt_signature ( void );
+
+//-----------------------------------------------------------------------------
+// Peer links are attached and detached by the service as connections come
+// and go. Notifications which do not fit into a peer transmit queue are held
+// as pending and re-issued when that queue drains. A changed resident value
+// is only notified while a peer is subscribed; otherwise it is marked dirty
+// and notified to the next peer that subscribes.
+//-----------------------------------------------------------------------------
+
+          unsigned                    gatt_attach ( gatt_service_t * gatt, unsigned short connection );
+          unsigned char               gatt_detach ( gatt_service_t * gatt, unsigned short connection );
+
+          gatt_link_t *               gatt_link ( gatt_service_t * gatt, unsigned short connection );
+          unsigned char               gatt_subscribed ( gatt_service_t * gatt, unsigned char link );
+          unsigned short              gatt_mtu ( gatt_service_t * gatt, unsigned char link );
+
+          unsigned                    gatt_notify ( gatt_service_t * gatt, unsigned char link, unsigned short connection );
+          unsigned                    gatt_mark ( gatt_service_t * gatt, unsigned char link );
+          unsigned                    gatt_complete ( gatt_service_t * gatt, unsigned short connection );
+
+//=============================================================================
+#endif
@@ -23,6 +23,7 @@
 
 static CTL_TASK_t *            thread = NULL;
 static peripheral_t          resource = { 0 };
+static bool                subscribed = false;
 
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
@@ -37,6 +38,9 @@ unsigned peripheral_start ( void ) {
 
   if ( (thread = ctl_spawn ( "peripheral", (CTL_TASK_ENTRY_t) peripheral_manager, peripheral, PERIPHERAL_MANAGER_STACK, PERIPHERAL_MANAGER_PRIORITY )) ) {
 
+    if ( ! subscribed ) { result = softble_subscribe ( (softble_subscriber_t) peripheral_event, peripheral ); }
+    if ( NRF_SUCCESS == result ) { subscribed = true; }
+
     } else { result = NRF_ERROR_NO_MEM; }
 
   return ( result );
@@ -175,6 +179,32 @@ unsigned peripheral_notice ( peripheral_notice_t notice, CTL_EVENT_SET_t * set,
   }
 
 
+//-----------------------------------------------------------------------------
+//  callback: peripheral_event ( peripheral, event )
+// arguments: peripheral - module resource
+//            event - BLE event structure
+//   returns: NRF_SUCCESS if event processed
+//
+// Count the linked peers. The attach and detach notices can coalesce in the
+// manager thread, so the count is kept from the stack events themselves.
+//-----------------------------------------------------------------------------
+
+static unsigned peripheral_event ( peripheral_t * peripheral, ble_evt_t * event ) {
+
+  switch ( event->header.evt_id ) {
+
+    case BLE_GAP_EVT_CONNECTED:   ctl_mutex_lock_uc ( &(peripheral->mutex) ); ++ peripheral->links; break;
+    case BLE_GAP_EVT_DISCONNECTED:ctl_mutex_lock_uc ( &(peripheral->mutex) ); if ( peripheral->links ) -- peripheral->links; break;
+
+    default:                      return ( NRF_SUCCESS );
+
+    }
+
+  return ( ctl_mutex_unlock ( &(peripheral->mutex) ), NRF_SUCCESS );
+
+  }
+
+
 //=============================================================================
 // SECTION : PERIPHERAL MANAGER THREAD
 //=============================================================================
@@ -230,11 +260,6 @@ static void peripheral_shutdown ( peripheral_t * peripheral ) {
 
   if ( NRF_SUCCESS == softble_advertisement_state ( &(enabled) ) ) { if ( enabled ) softble_advertisement_cease ( ); }
 
-  // If an advertisement has been constructed, free the buffers.
-
-  if ( peripheral->advertisement.data ) { free ( peripheral->advertisement.data ); }
-  if ( peripheral->advertisement.scan ) { free ( peripheral->advertisement.scan ); }
-
   }
 
 //-----------------------------------------------------------------------------
@@ -274,47 +299,29 @@ static void peripheral_configure ( peripheral_t * peripheral ) {
 
 static void peripheral_construct ( peripheral_t * peripheral ) {
 
-  softble_advertisement_t *      data = softble_advertisement_create ( );
-  softble_advertisement_t *      scan = softble_advertisement_create ( );
+  unsigned char                  next = peripheral->advertisement.active ^ 1;
+  softble_advertisement_t *      data = memset ( peripheral->advertisement.data + next, 0, sizeof(softble_advertisement_t) );
+  softble_advertisement_t *      scan = memset ( peripheral->advertisement.scan + next, 0, sizeof(softble_advertisement_t) );
 
-  // Construct the advertisement data packet.
+  // Construct the advertisement data packet in the buffers not in use by the
+  // stack.
 
-  if ( data ) {
-
-    softble_advertisement_append ( (softble_advertisement_t *) data, BLE_GAP_AD_TYPE_FLAGS, &(peripheral->broadcast.flags), sizeof(char) );
-    softble_advertisement_append ( (softble_advertisement_t *) data, BLE_GAP_AD_TYPE_SERVICE_DATA, information_identity ( ), sizeof(information_identity_t) );
-
-    }
+  softble_advertisement_append ( data, BLE_GAP_AD_TYPE_FLAGS, &(peripheral->broadcast.flags), sizeof(char) );
+  softble_advertisement_append ( data, BLE_GAP_AD_TYPE_SERVICE_DATA, information_identity ( ), sizeof(information_identity_t) );
 
   // Construct the scan response data packet.
 
-  if ( scan ) {
-
-    softble_advertisement_append ( (softble_advertisement_t *) scan, BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE, control_uuid ( ), sizeof(ble_uuid128_t) );
-
-    }
-
-  // If there is new advertising broadcast data, update the bluetooth
-  // stack with the new broadcast.
-
-  if ( data || scan ) {
-
-    // Update the BLE stack with the new advertising packet.
+  softble_advertisement_append ( scan, BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE, control_uuid ( ), sizeof(ble_uuid128_t) );
 
-    if ( NRF_SUCCESS == softble_advertisement_packet ( data, scan ) ) { ctl_events_set ( &(peripheral->status), PERIPHERAL_STATE_PACKET ); }
-    else { ctl_events_clear ( &(peripheral->status), PERIPHERAL_STATE_PACKET ); }
+  // Update the BLE stack with the new advertising packets. The new pair only
+  // becomes active once the stack has accepted it.
 
-    // Free the the old advertising data packets.
+  if ( NRF_SUCCESS == softble_advertisement_packet ( data, scan ) ) {
 
-    free ( peripheral->advertisement.data );
-    free ( peripheral->advertisement.scan );
+    ctl_events_set ( &(peripheral->status), PERIPHERAL_STATE_PACKET );
+    peripheral->advertisement.active  = next;
 
-    }
-
-  // Update the resource with the new advertisement records.
-
-  peripheral->advertisement.data      = data;
-  peripheral->advertisement.scan      = scan;
+    } else { ctl_events_clear ( &(peripheral->status), PERIPHERAL_STATE_PACKET ); }
 
   #ifdef DEBUG
   debug_printf ( "\r\nPeripheral: advertising" );
@@ -368,8 +375,15 @@ static void peripheral_inspected ( peripheral_t * peripheral ) {
 
 static void peripheral_attached ( peripheral_t * peripheral ) {
 
+  bool                          first = (peripheral->status & PERIPHERAL_STATE_LINKED) ? false : true;
+
   ctl_events_set_clear ( &(peripheral->status), PERIPHERAL_STATE_LINKED, PERIPHERAL_STATE_ACTIVE );
-  ctl_notice ( peripheral->notice + PERIPHERAL_NOTICE_ATTACHED );
+
+  // Connecting stops the advertisement. While there is room for another peer,
+  // re-open it.
+
+  if ( peripheral->links < BLUETOOTH_SERVER_LIMIT ) { ctl_events_set ( &(peripheral->status), PERIPHERAL_EVENT_BROADCAST ); }
+  if ( first ) { ctl_notice ( peripheral->notice + PERIPHERAL_NOTICE_ATTACHED ); }
 
   }
 
@@ -378,7 +392,14 @@ static void peripheral_attached ( peripheral_t * peripheral ) {
 
 static void peripheral_detached ( peripheral_t * peripheral ) {
 
-  ctl_events_clear ( &(peripheral->status), PERIPHERAL_STATE_LINKED );
-  ctl_notice ( peripheral->notice + PERIPHERAL_NOTICE_DETACHED );
+  // Once the last peer has gone, the peripheral is no longer linked. Otherwise
+  // a link has been freed, so advertise for another peer.
+
+  if ( peripheral->links == 0 ) {
+
+    ctl_events_clear ( &(peripheral->status), PERIPHERAL_STATE_LINKED );
+    ctl_notice ( peripheral->notice + PERIPHERAL_NOTICE_DETACHED );
+
+    } else if ( !(peripheral->status & PERIPHERAL_STATE_ACTIVE) ) { ctl_events_set ( &(peripheral->status), PERIPHERAL_EVENT_BROADCAST ); }
 
   }
\ No newline at end of file
@@ -42,16 +42,20 @@ typedef   struct {
 
             } broadcast;
 
+          unsigned char               links;                                    // Number of linked peers
+
           struct {                                                              // Peripheral advertisement:
 
-            softble_advertisement_t * data;                                     //  Advertisement data packet
-            softble_advertisement_t * scan;                                     //  Scan response data packet
+            softble_advertisement_t   data [ 2 ];                               //  Advertisement data packets
+            softble_advertisement_t   scan [ 2 ];                               //  Scan response data packets
+            unsigned char             active;                                   //  Packet pair in use by the stack
 
             } advertisement;
 
           } peripheral_t;
 
 static    void                        peripheral_manager ( peripheral_t * peripheral );
+static    unsigned                    peripheral_event ( peripheral_t * peripheral, ble_evt_t * event );
 
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
@@ -67,7 +71,7 @@ static    void                        peripheral_shutdown ( peripheral_t * perip
 #define   PERIPHERAL_STATE_ACTIVE     (1 << 29)                                 // Actively advertising
 #define   PERIPHERAL_STATE_PACKET     (1 << 28)                                 // Broadcast packet loaded
 #define   PERIPHERAL_STATE_PERIOD     (1 << 27)                                 // Broadcast period defined
-#define   PERIPHERAL_STATE_LINKED     (1 << 26)                                 // Currently linked to peer
+#define   PERIPHERAL_STATE_LINKED     (1 << 26)                                 // Currently linked to at least one peer
 
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
@@ -93,6 +97,9 @@ static    void                        peripheral_inspected ( peripheral_t * peri
 #define   PERIPHERAL_CLEAR_CEASE      (PERIPHERAL_STATE_PACKET | PERIPHERAL_STATE_ACTIVE)
 
 //-----------------------------------------------------------------------------
+// Up to BLUETOOTH_SERVER_LIMIT peers can be linked at once. Advertising is
+// re-opened while a link is free. The attached notice is issued for the first
+// peer and the detached notice once the last peer has gone.
 //-----------------------------------------------------------------------------
 
 #define   PERIPHERAL_EVENT_ATTACHED   (1 << 9)                                  // Construct the advertisement broadcast